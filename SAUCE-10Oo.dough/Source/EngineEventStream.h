@@ -0,0 +1,59 @@
+#pragma once
+#include "LockFreeMpscQueue.h"
+#include "PackedMidiEvent.h"
+
+// Compact record of what the engine saw and did, published for visualisers
+struct EngineEvent
+{
+    enum Type : uint8_t
+    {
+        inputNoteOn = 0,
+        inputNoteOff,
+        outputNoteOn,
+        outputNoteOff,
+        pedalDown,
+        pedalUp
+    };
+
+    double timestamp = 0; // Seconds, Time::getMillisecondCounterHiRes() based
+    uint8_t type = inputNoteOn;
+    uint8_t channel = 1;
+    uint8_t note = 0;
+    uint8_t velocity = 0;
+};
+
+// Engine threads push, a single GUI consumer drains. Events are dropped (never blocked on) when full.
+class EngineEventStream
+{
+public:
+    void publish(EngineEvent::Type type, int channel, int note, int velocity = 0)
+    {
+        EngineEvent e;
+        e.timestamp = juce::Time::getMillisecondCounterHiRes() * 0.001;
+        e.type = type;
+        e.channel = static_cast<uint8_t>(channel);
+        e.note = static_cast<uint8_t>(note & 0x7f);
+        e.velocity = static_cast<uint8_t>(velocity & 0x7f);
+
+        if (!queue.push(e))
+            droppedEvents.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void publishNote(const PackedMidiEvent& e, bool isOutput)
+    {
+        const bool on = e.isNoteOn();
+        const auto type = isOutput ? (on ? EngineEvent::outputNoteOn : EngineEvent::outputNoteOff)
+            : (on ? EngineEvent::inputNoteOn : EngineEvent::inputNoteOff);
+        publish(type, e.getChannel(), e.getData1(), e.getData2());
+    }
+
+    bool read(EngineEvent& e) { return queue.pop(e); }
+
+    int getNumDropped() const { return droppedEvents.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t STREAM_SIZE = 2048; // Several frames of very dense playing
+
+    LockFreeMpscQueue<EngineEvent, STREAM_SIZE> queue;
+    std::atomic<int> droppedEvents{ 0 };
+};
@@ -0,0 +1,142 @@
+#pragma once
+#include <iostream>
+#include "ShardedPedalEngine.h"
+
+// Headless throughput benchmark for the sharded pedal engine against its thread count:
+//   SAUCE10oOdough --benchmark-engine
+// The workload is a sequencer playing all 16 channels at once - notes walking up and down under
+// a sustain pedal that goes down and up on every channel. The calling thread feeds the shards
+// the way the merge thread would, and a separate output-stage thread drains them.
+class EngineScalingBenchmark
+{
+public:
+    static void run(std::ostream& out, int numEvents = DEFAULT_EVENTS)
+    {
+        const auto workload = makeWorkload(numEvents);
+        const PedalMapper mapper;
+
+        out << "Engine scaling benchmark (" << numEvents << " events on 16 channels, best of "
+            << RUNS << " runs)\n";
+        out << juce::String::formatted("%-8s %14s %9s %10s\n", "threads", "events/s", "speedup", "output");
+
+        double baseline = 0;
+
+        for (const int threads : threadCounts)
+        {
+            double best = 0;
+            int64_t written = 0;
+
+            for (int run = 0; run < RUNS; ++run)
+            {
+                const auto r = measure(mapper, workload, threads);
+                best = juce::jmax(best, r.eventsPerSecond);
+                written = r.written;
+            }
+
+            if (baseline == 0)
+                baseline = best;
+
+            // The output count must not depend on the thread count
+            out << juce::String::formatted("%-8d %14.0f %8.2fx %10lld\n",
+                threads, best, best / baseline, static_cast<long long>(written));
+        }
+
+        out.flush();
+    }
+
+private:
+    struct Result
+    {
+        double eventsPerSecond = 0;
+        int64_t written = 0;
+    };
+
+    // Stands in for the output scheduler: drains the shards until told to stop
+    class OutputStage : public juce::Thread
+    {
+    public:
+        OutputStage(ShardedPedalEngine& engineToDrain)
+            : juce::Thread("Benchmark Output Stage"),
+            engine(engineToDrain)
+        {
+        }
+
+        void run() override
+        {
+            while (!threadShouldExit())
+            {
+                if (engine.drain([this](const PackedMidiEvent&) { ++written; }) == 0)
+                    juce::Thread::yield();
+            }
+
+            engine.drain([this](const PackedMidiEvent&) { ++written; });
+        }
+
+        ShardedPedalEngine& engine;
+        int64_t written = 0; // Read once the thread has stopped
+    };
+
+    static Result measure(const PedalMapper& mapper, const std::vector<PackedMidiEvent>& workload, int threads)
+    {
+        ShardedPedalEngine engine(mapper, threads);
+        OutputStage outputStage(engine);
+        engine.start();
+        outputStage.startThread(juce::Thread::Priority::high);
+
+        const auto start = juce::Time::getHighResolutionTicks();
+
+        for (const auto& event : workload)
+        {
+            // A full shard ring pushes back on the producer rather than losing the event
+            while (!engine.push(event))
+                juce::Thread::yield();
+        }
+
+        while (!engine.isIdle())
+            juce::Thread::yield();
+
+        outputStage.stopThread(2000);
+        const auto ticks = juce::Time::getHighResolutionTicks() - start;
+        engine.stop();
+
+        Result r;
+        r.eventsPerSecond = static_cast<double>(workload.size()) / juce::Time::highResolutionTicksToSeconds(ticks);
+        r.written = outputStage.written;
+        return r;
+    }
+
+    // Channel after channel, each one a step further through its own pattern of 32 steps: the
+    // sustain pedal down for the first half and up for the second, each half opening with an
+    // expression change and then walking through note-on/note-off pairs
+    static std::vector<PackedMidiEvent> makeWorkload(int numEvents)
+    {
+        std::vector<PackedMidiEvent> events;
+        events.reserve(static_cast<size_t>(numEvents));
+
+        for (int i = 0; i < numEvents; ++i)
+        {
+            const int channel = i % 16 + 1;
+            const int step = i / 16;
+            const auto tick = static_cast<uint32_t>(i) * TICKS_PER_EVENT;
+            const int phase = step % 32;
+            const int note = 36 + (step / 2 * 7 + channel) % 48;
+
+            if (phase == 0 || phase == 16)
+                events.push_back(PackedMidiEvent::controller(channel, 64, phase == 0 ? 127 : 0, tick));
+            else if (phase == 1 || phase == 17)
+                events.push_back(PackedMidiEvent::controller(channel, 11, step % 128, tick));
+            else if (phase % 2 == 0)
+                events.push_back(PackedMidiEvent::noteOn(channel, note, 100, tick));
+            else
+                events.push_back(PackedMidiEvent::noteOff(channel, note, tick));
+        }
+
+        return events;
+    }
+
+    //==============================================================================
+    static constexpr int DEFAULT_EVENTS = 2000000;
+    static constexpr int RUNS = 3;
+    static constexpr uint32_t TICKS_PER_EVENT = 10;
+    static constexpr int threadCounts[] = { 1, 2, 4, 8, 16 };
+};
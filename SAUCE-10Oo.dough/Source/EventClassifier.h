@@ -0,0 +1,220 @@
+#pragma once
+#include "PackedMidiEvent.h"
+
+#if defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+ #define SAUCE_CLASSIFIER_X86 1
+ #include <immintrin.h>
+#else
+ #define SAUCE_CLASSIFIER_X86 0
+#endif
+
+#if SAUCE_CLASSIFIER_X86 && (defined(__GNUC__) || defined(__clang__))
+ #define SAUCE_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+ #define SAUCE_TARGET_AVX2
+#endif
+
+// Sorts a contiguous array of packed events into one bitmask per class in a single pass,
+// so batch stages can loop over just the events they care about instead of re-testing each one.
+// Four (SSE2) or eight (AVX2) status words are compared per step; the kernel is picked once at
+// run time, with a scalar fallback for other CPUs.
+class EventClassifier
+{
+public:
+    enum Class
+    {
+        note = 0,  // Note-on / note-off
+        sostenuto, // CC66
+        controller, // Any other CC
+        realtime,  // 0xF8-0xFF
+        sysex,     // 0xF0
+        other,     // Everything else
+        numClasses
+    };
+
+    static constexpr uint32_t classBit(Class c) { return 1u << c; }
+
+    void classify(const PackedMidiEvent* events, size_t count)
+    {
+        static_assert(sizeof(PackedMidiEvent) == 8, "The kernels assume tightly packed 8-byte events");
+
+        numEvents = count;
+        const size_t numWords = (count + 63) / 64;
+
+        for (auto& mask : masks)
+            mask.assign(numWords, 0);
+
+        uint64_t* out[] = { masks[note].data(), masks[sostenuto].data(), masks[controller].data(),
+            masks[realtime].data(), masks[sysex].data() };
+
+        getKernel()(events, count, out);
+
+        // Whatever no kernel class claimed, limited to the events that exist
+        for (size_t w = 0; w < numWords; ++w)
+        {
+            const uint64_t valid = (w + 1) * 64 <= count ? ~0ULL : (1ULL << (count & 63)) - 1;
+            masks[other][w] = ~(masks[note][w] | masks[sostenuto][w] | masks[controller][w]
+                | masks[realtime][w] | masks[sysex][w]) & valid;
+        }
+    }
+
+    // Call fn(index) for every event in any of the classes in classSet, in array order
+    template <typename Fn>
+    void forEach(uint32_t classSet, Fn&& fn) const
+    {
+        for (size_t w = 0; w < masks[0].size(); ++w)
+        {
+            uint64_t bits = 0;
+            for (int c = 0; c < numClasses; ++c)
+                bits |= (classSet & (1u << c)) != 0 ? masks[c][w] : 0;
+
+            while (bits != 0)
+            {
+                fn(w * 64 + static_cast<size_t>(countTrailingZeros(bits)));
+                bits &= bits - 1;
+            }
+        }
+    }
+
+    const std::vector<uint64_t>& getMask(Class c) const { return masks[c]; }
+    size_t size() const { return numEvents; }
+
+    static const char* getKernelName()
+    {
+        const auto kernel = getKernel();
+#if SAUCE_CLASSIFIER_X86
+        if (kernel == &classifyAvx2) return "AVX2";
+        if (kernel == &classifySse2) return "SSE2";
+#endif
+        return kernel == &classifyScalar ? "scalar" : "unknown";
+    }
+
+private:
+    using Kernel = void (*)(const PackedMidiEvent*, size_t, uint64_t* const*);
+
+    static Kernel getKernel()
+    {
+        static const Kernel kernel = [] {
+#if SAUCE_CLASSIFIER_X86
+            return juce::SystemStats::hasAVX2() ? &classifyAvx2 : &classifySse2;
+#else
+            return &classifyScalar;
+#endif
+        }();
+
+        return kernel;
+    }
+
+    // Mask/value pairs for the status word: status | data1 << 8 | data2 << 16
+    static constexpr int NOTE_MASK = 0xe0, NOTE_VALUE = 0x80;               // 0x8n and 0x9n
+    static constexpr int SOSTENUTO_MASK = 0x7ff0, SOSTENUTO_VALUE = 0x42b0; // 0xBn, controller 66
+    static constexpr int CONTROLLER_MASK = 0xf0, CONTROLLER_VALUE = 0xb0;
+    static constexpr int REALTIME_MASK = 0xf8, REALTIME_VALUE = 0xf8;
+    static constexpr int SYSEX_MASK = 0xff, SYSEX_VALUE = 0xf0;
+
+    static void classifyScalarRange(const PackedMidiEvent* events, size_t begin, size_t end, uint64_t* const* out)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            const uint32_t w = events[i].bytes;
+            const uint64_t bit = 1ULL << (i & 63);
+            const bool isSostenuto = (w & SOSTENUTO_MASK) == SOSTENUTO_VALUE;
+
+            out[note][i / 64] |= (w & NOTE_MASK) == NOTE_VALUE ? bit : 0;
+            out[sostenuto][i / 64] |= isSostenuto ? bit : 0;
+            out[controller][i / 64] |= (w & CONTROLLER_MASK) == CONTROLLER_VALUE && !isSostenuto ? bit : 0;
+            out[realtime][i / 64] |= (w & REALTIME_MASK) == REALTIME_VALUE ? bit : 0;
+            out[sysex][i / 64] |= (w & SYSEX_MASK) == SYSEX_VALUE ? bit : 0;
+        }
+    }
+
+    static void classifyScalar(const PackedMidiEvent* events, size_t count, uint64_t* const* out)
+    {
+        classifyScalarRange(events, 0, count, out);
+    }
+
+#if SAUCE_CLASSIFIER_X86
+    static int testSse2(__m128i words, int mask, int value)
+    {
+        const __m128i eq = _mm_cmpeq_epi32(_mm_and_si128(words, _mm_set1_epi32(mask)), _mm_set1_epi32(value));
+        return _mm_movemask_ps(_mm_castsi128_ps(eq));
+    }
+
+    static void classifySse2(const PackedMidiEvent* events, size_t count, uint64_t* const* out)
+    {
+        size_t i = 0;
+
+        // Four events (two per register) per step; 4 divides 64, so a step never straddles mask words
+        for (; i + 4 <= count; i += 4)
+        {
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(events + i));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(events + i + 2));
+
+            // Keep the status words (even 32-bit lanes), dropping the ticks
+            const __m128i words = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), _MM_SHUFFLE(2, 0, 2, 0)));
+
+            const int isSostenuto = testSse2(words, SOSTENUTO_MASK, SOSTENUTO_VALUE);
+            const int shift = static_cast<int>(i & 63);
+
+            out[note][i / 64] |= (uint64_t)testSse2(words, NOTE_MASK, NOTE_VALUE) << shift;
+            out[sostenuto][i / 64] |= (uint64_t)isSostenuto << shift;
+            out[controller][i / 64] |= (uint64_t)(testSse2(words, CONTROLLER_MASK, CONTROLLER_VALUE) & ~isSostenuto) << shift;
+            out[realtime][i / 64] |= (uint64_t)testSse2(words, REALTIME_MASK, REALTIME_VALUE) << shift;
+            out[sysex][i / 64] |= (uint64_t)testSse2(words, SYSEX_MASK, SYSEX_VALUE) << shift;
+        }
+
+        classifyScalarRange(events, i, count, out);
+    }
+
+    SAUCE_TARGET_AVX2 static int testAvx2(__m256i words, int mask, int value)
+    {
+        const __m256i eq = _mm256_cmpeq_epi32(_mm256_and_si256(words, _mm256_set1_epi32(mask)), _mm256_set1_epi32(value));
+        return _mm256_movemask_ps(_mm256_castsi256_ps(eq));
+    }
+
+    SAUCE_TARGET_AVX2 static void classifyAvx2(const PackedMidiEvent* events, size_t count, uint64_t* const* out)
+    {
+        size_t i = 0;
+
+        for (; i + 8 <= count; i += 8)
+        {
+            const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(events + i));
+            const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(events + i + 4));
+
+            // The shuffle works per 128-bit half and yields events 0,1,4,5 | 2,3,6,7 - the permute restores order
+            const __m256i mixed = _mm256_castps_si256(_mm256_shuffle_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b), _MM_SHUFFLE(2, 0, 2, 0)));
+            const __m256i words = _mm256_permute4x64_epi64(mixed, _MM_SHUFFLE(3, 1, 2, 0));
+
+            const int isSostenuto = testAvx2(words, SOSTENUTO_MASK, SOSTENUTO_VALUE);
+            const int shift = static_cast<int>(i & 63);
+
+            out[note][i / 64] |= (uint64_t)testAvx2(words, NOTE_MASK, NOTE_VALUE) << shift;
+            out[sostenuto][i / 64] |= (uint64_t)isSostenuto << shift;
+            out[controller][i / 64] |= (uint64_t)(testAvx2(words, CONTROLLER_MASK, CONTROLLER_VALUE) & ~isSostenuto) << shift;
+            out[realtime][i / 64] |= (uint64_t)testAvx2(words, REALTIME_MASK, REALTIME_VALUE) << shift;
+            out[sysex][i / 64] |= (uint64_t)testAvx2(words, SYSEX_MASK, SYSEX_VALUE) << shift;
+        }
+
+        classifyScalarRange(events, i, count, out);
+    }
+#endif
+
+    static int countTrailingZeros(uint64_t x)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, x);
+        return static_cast<int>(index);
+#elif defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctzll(x);
+#else
+        int count = 0;
+        while ((x & 1) == 0) { x >>= 1; ++count; }
+        return count;
+#endif
+    }
+
+    //==============================================================================
+    std::vector<uint64_t> masks[numClasses];
+    size_t numEvents = 0;
+};
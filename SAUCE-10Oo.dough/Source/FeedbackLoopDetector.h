@@ -0,0 +1,132 @@
+#pragma once
+#include "PackedMidiEvent.h"
+
+// Recognises the output being routed back to the input (a virtual cable, a DAW thru, a hardware
+// merge), which would otherwise re-forward every event for ever.
+//
+// Everything written to the output is fingerprinted (status and both data bytes) into a ring of
+// short time buckets, each a 1024-bit hash set. An incoming event is an echo if its fingerprint
+// was sent within the ring's window - a few milliseconds, far shorter than anyone plays the same
+// key or value twice. One echo proves nothing (a controller may repeat a value); a loop is when
+// most of the recent input is echoes and arrives faster than any performer sends it.
+//
+// Both sides cost a handful of bit operations and never allocate. System real-time and SysEx are
+// not fingerprinted: a clock repeats itself by design.
+class FeedbackLoopDetector
+{
+public:
+    // Called for every event written to the output
+    void recordSent(const PackedMidiEvent& e)
+    {
+        if (!isFingerprinted(e))
+            return;
+
+        const juce::SpinLock::ScopedLockType sl(lock);
+        auto& bucket = getBucket(juce::Time::getMillisecondCounter() / BUCKET_MS);
+        const auto hash = getHash(e);
+        bucket.bits[hash >> 6] |= 1ULL << (hash & 63);
+    }
+
+    // Called for every incoming event. Returns true when this event completes a loop: the input
+    // is then cut until resume().
+    bool isEchoLoop(const PackedMidiEvent& e)
+    {
+        if (!isFingerprinted(e))
+            return false;
+
+        const juce::SpinLock::ScopedLockType sl(lock);
+        const auto now = juce::Time::getMillisecondCounter();
+        const auto hash = getHash(e);
+        bool isEcho = false;
+
+        for (const auto& bucket : buckets)
+        {
+            if (now / BUCKET_MS - bucket.stamp < NUM_BUCKETS && (bucket.bits[hash >> 6] >> (hash & 63) & 1) != 0)
+                isEcho = true;
+        }
+
+        // The last WINDOW_EVENTS inputs: which were echoes, and when the oldest arrived
+        echoHistory = echoHistory << 1 | (isEcho ? 1u : 0u);
+        const auto oldest = arrivals[nextArrival];
+        arrivals[nextArrival] = now;
+        nextArrival = (nextArrival + 1) % WINDOW_EVENTS;
+
+        if (countBits(echoHistory) < MIN_ECHOES || oldest == 0 || now - oldest > MAX_WINDOW_MS)
+            return false;
+
+        cut.store(true, std::memory_order_relaxed);
+        cuts.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool isCut() const { return cut.load(std::memory_order_relaxed); }
+
+    // The user has broken the loop (or wants to try again)
+    void resume()
+    {
+        const juce::SpinLock::ScopedLockType sl(lock);
+        echoHistory = 0;
+        std::fill(std::begin(arrivals), std::end(arrivals), 0u);
+        cut.store(false, std::memory_order_relaxed);
+    }
+
+    int64_t getCutCount() const { return cuts.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr uint32_t BUCKET_MS = 2;
+    static constexpr uint32_t NUM_BUCKETS = 8;     // Echo window of 14-16 ms
+    static constexpr int WINDOW_EVENTS = 64;
+    static constexpr int MIN_ECHOES = 48;          // Three quarters of the recent input...
+    static constexpr uint32_t MAX_WINDOW_MS = 100; // ...at 640 events per second or more
+
+    struct Bucket
+    {
+        uint32_t stamp = 0; // Bucket number (time / BUCKET_MS) the bits belong to
+        uint64_t bits[16] = {};
+    };
+
+    static bool isFingerprinted(const PackedMidiEvent& e) { return e.getStatus() != 0xf0 && !e.isSystemRealTime(); }
+
+    static uint32_t getHash(const PackedMidiEvent& e)
+    {
+        const auto key = static_cast<uint32_t>(e.getStatus() << 16 | e.getData1() << 8 | e.getData2());
+        return (key * 0x9e3779b1u) >> 22; // 10 bits
+    }
+
+    // The bucket for this time slot, emptied if it still holds an older slot's fingerprints
+    Bucket& getBucket(uint32_t slot)
+    {
+        auto& bucket = buckets[slot % NUM_BUCKETS];
+
+        if (bucket.stamp != slot)
+        {
+            std::fill(std::begin(bucket.bits), std::end(bucket.bits), 0ULL);
+            bucket.stamp = slot;
+        }
+
+        return bucket;
+    }
+
+    static int countBits(uint64_t x)
+    {
+#if defined(_MSC_VER) && defined(_M_X64)
+        return static_cast<int>(__popcnt64(x));
+#elif defined(__GNUC__) || defined(__clang__)
+        return __builtin_popcountll(x);
+#else
+        int count = 0;
+        for (; x != 0; x &= x - 1)
+            ++count;
+        return count;
+#endif
+    }
+
+    //==============================================================================
+    juce::SpinLock lock;
+    Bucket buckets[NUM_BUCKETS];
+    uint64_t echoHistory = 0;
+    uint32_t arrivals[WINDOW_EVENTS] = {};
+    int nextArrival = 0;
+    std::atomic<bool> cut{ false };
+    std::atomic<int64_t> cuts{ 0 };
+};
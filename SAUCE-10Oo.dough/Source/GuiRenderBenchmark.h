@@ -0,0 +1,208 @@
+#pragma once
+#include <iostream>
+
+// Headless paint-time benchmark for the main window's children.
+// Components are never put on the desktop - everything renders into software images,
+// so this runs on a Linux box without a display server:  SAUCE10oOdough --benchmark-gui
+class GuiRenderBenchmark
+{
+public:
+    struct Result
+    {
+        juce::String name;
+        int width = 0;
+        int height = 0;
+        float scale = 1.0f;
+        double meanMs = 0;
+        double p95Ms = 0;
+        double maxMs = 0;
+    };
+
+    static void run(std::ostream& out, int framesPerCase = DEFAULT_FRAMES)
+    {
+        out << "GUI render benchmark (" << framesPerCase << " frames per case, times in ms)\n";
+        out << juce::String::formatted("%-22s %11s %6s %9s %9s %9s\n",
+            "component", "size", "scale", "mean", "p95", "max");
+
+        for (const auto& size : sizes)
+        {
+            for (const float scale : scales)
+            {
+                GuiRenderBenchmark bench(size.x, size.y);
+
+                for (const auto& r : bench.runAll(scale, framesPerCase))
+                {
+                    out << juce::String::formatted("%-22s %5dx%-5d %6.1f %9.3f %9.3f %9.3f\n",
+                        r.name.toRawUTF8(), r.width, r.height, r.scale, r.meanMs, r.p95Ms, r.maxMs);
+                }
+            }
+        }
+
+        out.flush();
+    }
+
+private:
+    GuiRenderBenchmark(int windowWidth, int windowHeight)
+        : keyboard(keyboardState, juce::MidiKeyboardComponent::horizontalKeyboard),
+        pedal("\n\nSAUCE\n\n10\n\noO\n\ndough\n\n")
+    {
+        MainContentComponent::configureMessagesBox(logView);
+        keyboard.setSostenutoSource(sostenutoBitmap);
+
+        // Same proportions as MainContentComponent::resized()
+        keyboard.setBounds(8, 36 + 8, windowWidth - 16, 80 - 16);
+        pedal.setBounds(0, 0, 50, 100);
+        logView.setBounds(8, 36 + 80 + 8, windowWidth - 16, juce::jmax(40, windowHeight - 36 - 80 - 110 - 16));
+    }
+
+    std::vector<Result> runAll(float scale, int frames)
+    {
+        std::vector<Result> results;
+
+        results.push_back(measure("PedalButton", pedal, scale, frames, [this](int frame) {
+            pedal.setToggleState((frame & 1) != 0, juce::dontSendNotification);
+            return juce::RectangleList<int>();
+        }));
+
+        results.push_back(measure("Keyboard (full)", keyboard, scale, frames, [this](int frame) {
+            stepKeyboard(frame);
+            return juce::RectangleList<int>();
+        }));
+
+        // Same script, but only the changed keys are painted - what repaint() asks for at runtime
+        results.push_back(measure("Keyboard (dirty keys)", keyboard, scale, frames, [this](int frame) {
+            return stepKeyboard(frame);
+        }));
+
+        results.push_back(measure("Log view", logView, scale, frames, [this](int frame) {
+            appendLogLine(frame);
+            return juce::RectangleList<int>();
+        }));
+
+        return results;
+    }
+
+    // Paint the component once per frame after applying a scripted state change.
+    // A non-empty rectangle list restricts painting to those regions.
+    template <typename StateChange>
+    static Result measure(const juce::String& name, juce::Component& component, float scale, int frames, StateChange&& change)
+    {
+        const int w = juce::jmax(1, juce::roundToInt(component.getWidth() * scale));
+        const int h = juce::jmax(1, juce::roundToInt(component.getHeight() * scale));
+        juce::Image image(juce::Image::ARGB, w, h, true, juce::SoftwareImageType());
+
+        std::vector<double> times;
+        times.reserve(static_cast<size_t>(frames));
+
+        for (int frame = -WARMUP_FRAMES; frame < frames; ++frame)
+        {
+            const auto dirty = change(frame + WARMUP_FRAMES);
+            const auto start = juce::Time::getHighResolutionTicks();
+
+            {
+                juce::Graphics g(image);
+                g.addTransform(juce::AffineTransform::scale(scale));
+
+                if (!dirty.isEmpty())
+                    g.reduceClipRegion(dirty);
+
+                component.paintEntireComponent(g, false);
+            }
+
+            const auto ticks = juce::Time::getHighResolutionTicks() - start;
+
+            if (frame >= 0)
+                times.push_back(juce::Time::highResolutionTicksToSeconds(ticks) * 1000.0);
+        }
+
+        Result r;
+        r.name = name;
+        r.width = component.getWidth();
+        r.height = component.getHeight();
+        r.scale = scale;
+
+        if (!times.empty())
+        {
+            double total = 0;
+            for (const double t : times)
+                total += t;
+
+            r.meanMs = total / static_cast<double>(times.size());
+            std::sort(times.begin(), times.end());
+            r.p95Ms = times[juce::jmin(times.size() - 1, times.size() * 95 / 100)];
+            r.maxMs = times.back();
+        }
+
+        return r;
+    }
+
+    // Play a walking pattern and periodically catch/release it with the pedal.
+    // Returns the rectangles of every key whose appearance changed.
+    juce::RectangleList<int> stepKeyboard(int frame)
+    {
+        juce::RectangleList<int> dirty;
+        const int note = 36 + (frame * 7) % 48;
+
+        if ((frame & 1) == 0)
+        {
+            keyboardState.noteOn(1, note, 0.8f);
+            pressedBits[note >> 6] |= 1ULL << (note & 63);
+            lastNote = note;
+        }
+        else if (lastNote >= 0)
+        {
+            keyboardState.noteOff(1, lastNote, 0.0f);
+            pressedBits[lastNote >> 6] &= ~(1ULL << (lastNote & 63));
+        }
+
+        dirty.add(keyboard.getRectangleForKey(frame & 1 ? lastNote : note).getSmallestIntegerContainer());
+
+        // Pedal down every 16 frames for 8 frames, capturing whatever is pressed
+        const int phase = frame % 16;
+        if (phase == 0 || phase == 8)
+        {
+            const uint64_t next[2] = { phase == 0 ? pressedBits[0] : 0, phase == 0 ? pressedBits[1] : 0 };
+
+            for (size_t k = 0; k < 2; ++k)
+            {
+                uint64_t changed = next[k] ^ sostenutoBitmap[k].load();
+                sostenutoBitmap[k].store(next[k]);
+
+                for (int bit = 0; changed != 0; ++bit, changed >>= 1)
+                    if (changed & 1)
+                        dirty.add(keyboard.getRectangleForKey(static_cast<int>(k) * 64 + bit).getSmallestIntegerContainer());
+            }
+
+            keyboard.checkSostenutoState();
+        }
+
+        return dirty;
+    }
+
+    void appendLogLine(int frame)
+    {
+        logView.moveCaretToEnd();
+        logView.insertTextAtCaret(juce::String::formatted("00:00:%02d.%03d  -  Note on C%d (Benchmark)\n",
+            (frame / 1000) % 60, frame % 1000, frame % 8));
+
+        // Keep the document bounded the way trimLogIfNeeded() does
+        if (frame % LOG_TRIM_INTERVAL == LOG_TRIM_INTERVAL - 1)
+            logView.clear();
+    }
+
+    //==============================================================================
+    static constexpr int DEFAULT_FRAMES = 200;
+    static constexpr int WARMUP_FRAMES = 10;
+    static constexpr int LOG_TRIM_INTERVAL = 500;
+    static constexpr juce::Point<int> sizes[] = { { 600, 400 }, { 1280, 720 }, { 1920, 1080 } };
+    static constexpr float scales[] = { 1.0f, 1.5f, 2.0f };
+
+    juce::MidiKeyboardState keyboardState;
+    std::atomic<uint64_t> sostenutoBitmap[2] = { {0}, {0} };
+    uint64_t pressedBits[2] = { 0, 0 };
+    int lastNote = -1;
+
+    SostenutoKeyboardComponent keyboard;
+    PedalButton pedal;
+    juce::TextEditor logView;
+};
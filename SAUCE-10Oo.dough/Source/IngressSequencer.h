@@ -0,0 +1,205 @@
+#pragma once
+#include "PackedMidiEvent.h"
+
+// An incoming event tagged with its position in the single ingress order
+struct SequencedMidiEvent
+{
+    uint32_t sequence = 0;
+    PackedMidiEvent event;
+};
+
+// Gives every incoming event a sequence number and owns the deferred lane.
+// Notes and pedal events are still handled immediately on the input thread; everything else
+// waits in the deferred lane for the message thread. The reorder rules keep that split from
+// changing what the musician played:
+//
+//  - Channel messages deferred before a note or pedal event on the same channel are flushed
+//    ahead of it (a CC64 or program change sent just before a note arrives before the note).
+//  - Channel-less messages (SysEx, system common) and other channels keep their deferred order.
+//  - Within the deferred lane, order is always the ingress order.
+//
+// The lane holds at most CAPACITY events and never allocates after construction; the owner
+// decides what happens when it is full (see isFull). Depth and overload are measured here.
+//
+// All deferred-lane methods must be called with the owner's processing lock held.
+class IngressSequencer
+{
+public:
+    IngressSequencer()
+    {
+        deferred.reserve(CAPACITY);
+        scratch.reserve(CAPACITY);
+    }
+
+    // Safe from any thread
+    uint32_t next() { return counter.fetch_add(1, std::memory_order_relaxed); }
+
+    static constexpr size_t CAPACITY = 4096;
+
+    // Only ever called below CAPACITY, so the lane's storage is never reallocated
+    void defer(uint32_t sequence, const PackedMidiEvent& event)
+    {
+        jassert(!isFull());
+
+        // Something was handled on the real-time lane since the last deferred event
+        if (sequence != nextSequence)
+            runStart = deferred.size();
+
+        nextSequence = sequence + 1;
+        deferred.push_back({ sequence, event });
+        ++pendingPerChannel[event.getChannel()]; // 0 for channel-less messages
+        recordDepth();
+    }
+
+    bool hasDeferred() const { return !deferred.empty(); }
+    bool isFull() const { return deferred.size() >= CAPACITY; }
+
+    // Set when compacting left the lane more than three quarters full, until it drains below
+    // that. Meanwhile the owner coalesces each new value into the lane (see replace) instead of
+    // compacting again for every event.
+    bool isCoalescing() const { return coalescing; }
+
+    // Overwrite the queued value a newer one supersedes, in place, instead of deferring it.
+    // Only the run at the tail of the lane is searched - events deferred since the last barrier,
+    // with nothing handled on the real-time lane in between - so the value never moves across a
+    // note, a pedal or any message getKey(event) returns -1 for. Returns false if there is
+    // nothing to overwrite, in which case the event still has to be deferred.
+    template <typename KeyFn>
+    bool replace(uint32_t sequence, const PackedMidiEvent& event, KeyFn&& getKey)
+    {
+        const int key = getKey(event);
+
+        if (key < 0 || sequence != nextSequence)
+            return false;
+
+        for (size_t i = deferred.size(); i > runStart; --i)
+        {
+            auto& queued = deferred[i - 1];
+            const int queuedKey = getKey(queued.event);
+
+            if (queuedKey < 0)
+                return false;
+
+            if (queuedKey == key)
+            {
+                queued.event = event;
+                nextSequence = sequence + 1;
+                coalesced.fetch_add(1, std::memory_order_relaxed);
+                recordOverload();
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // Rewrite the lane in place with fn(std::vector<SequencedMidiEvent>&), which may only remove
+    // events (the owner's coalescer, when the lane fills up)
+    template <typename Fn>
+    void compact(Fn&& fn)
+    {
+        fn(deferred);
+        std::fill(std::begin(pendingPerChannel), std::end(pendingPerChannel), 0);
+
+        for (const auto& e : deferred)
+            ++pendingPerChannel[e.event.getChannel()];
+
+        runStart = deferred.size();
+        recordDepth();
+        coalescing = isNearlyFull();
+    }
+
+    // Move out every deferred event on `channel` that is waiting ahead of a real-time event.
+    // Returns an empty list (without touching the lane) in the common case of nothing pending.
+    const std::vector<SequencedMidiEvent>& takeAheadOf(int channel)
+    {
+        scratch.clear();
+
+        if (channel < 1 || channel > 16 || pendingPerChannel[channel] == 0)
+            return scratch;
+
+        // Stable in-place partition: matching events go to scratch, the rest are compacted
+        size_t write = 0;
+        for (size_t read = 0; read < deferred.size(); ++read)
+        {
+            if (deferred[read].event.getChannel() == channel)
+                scratch.push_back(deferred[read]);
+            else
+                deferred[write++] = deferred[read];
+        }
+
+        deferred.resize(write);
+        runStart = write;
+        pendingPerChannel[channel] = 0;
+        recordDepth();
+        flushedAhead.fetch_add(static_cast<int64_t>(scratch.size()), std::memory_order_relaxed);
+        return scratch;
+    }
+
+    // Move out the whole deferred lane, in ingress order
+    const std::vector<SequencedMidiEvent>& takeAll()
+    {
+        scratch.clear();
+        scratch.swap(deferred);
+        runStart = 0;
+        std::fill(std::begin(pendingPerChannel), std::end(pendingPerChannel), 0);
+        recordDepth();
+        return scratch;
+    }
+
+    //==============================================================================
+    // Overload accounting - safe from any thread
+    // The lane or the output could not absorb a burst
+    void recordOverload()
+    {
+        overloads.fetch_add(1, std::memory_order_relaxed);
+        lastOverloadMs.store(juce::Time::getMillisecondCounter(), std::memory_order_relaxed);
+    }
+
+    // Warning state: overloaded within the last OVERLOAD_HOLD_MS
+    bool isOverloaded() const
+    {
+        const auto last = lastOverloadMs.load(std::memory_order_relaxed);
+        return last != 0 && juce::Time::getMillisecondCounter() - last < OVERLOAD_HOLD_MS;
+    }
+
+    // Values overwritten in the lane by replace(); nothing is ever dropped outright
+    int64_t getCoalescedCount() const { return coalesced.load(std::memory_order_relaxed); }
+    int64_t getOverloadCount() const { return overloads.load(std::memory_order_relaxed); }
+    int getDepth() const { return depth.load(std::memory_order_relaxed); }
+    int getPeakDepth() const { return peakDepth.load(std::memory_order_relaxed); }
+
+    // Events sent ahead of a note by the reorder rules, safe to read from any thread
+    int64_t getFlushedAheadCount() const { return flushedAhead.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr uint32_t OVERLOAD_HOLD_MS = 1000;
+
+    bool isNearlyFull() const { return deferred.size() > CAPACITY * 3 / 4; }
+
+    void recordDepth()
+    {
+        if (!isNearlyFull())
+            coalescing = false;
+
+        const int size = static_cast<int>(deferred.size());
+        depth.store(size, std::memory_order_relaxed);
+
+        if (size > peakDepth.load(std::memory_order_relaxed))
+            peakDepth.store(size, std::memory_order_relaxed); // Only written under the owner's lock
+    }
+
+    std::atomic<uint32_t> counter{ 0 };
+    std::vector<SequencedMidiEvent> deferred;
+    std::vector<SequencedMidiEvent> scratch;
+    int pendingPerChannel[17] = {};
+    uint32_t nextSequence = 0; // One past the last event deferred or replaced
+    size_t runStart = 0;       // Index where the run at the tail of the lane begins
+    bool coalescing = false;
+    std::atomic<int64_t> flushedAhead{ 0 };
+    std::atomic<int> depth{ 0 };
+    std::atomic<int> peakDepth{ 0 };
+    std::atomic<int64_t> coalesced{ 0 };
+    std::atomic<int64_t> overloads{ 0 };
+    std::atomic<uint32_t> lastOverloadMs{ 0 };
+};
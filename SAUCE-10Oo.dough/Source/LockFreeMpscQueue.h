@@ -0,0 +1,86 @@
+#pragma once
+
+// Bounded multi-producer / single-consumer ring with per-slot sequence numbers.
+// push() never blocks or allocates - when the ring is full it fails and the caller decides what to drop.
+template <typename T, size_t Capacity>
+class LockFreeMpscQueue
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    LockFreeMpscQueue()
+    {
+        for (size_t i = 0; i < Capacity; ++i)
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    // Safe to call from any number of threads
+    bool push(const T& value)
+    {
+        size_t pos = head.load(std::memory_order_relaxed);
+
+        for (;;)
+        {
+            Slot& slot = slots[pos & mask];
+            const size_t seq = slot.sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+
+            if (diff == 0)
+            {
+                if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    slot.value = value;
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false; // Full
+            }
+            else
+            {
+                pos = head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Only ever call from the single consumer thread
+    bool pop(T& value)
+    {
+        const size_t pos = tail.load(std::memory_order_relaxed);
+        Slot& slot = slots[pos & mask];
+        const size_t seq = slot.sequence.load(std::memory_order_acquire);
+
+        if (static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1) < 0)
+            return false; // Empty
+
+        value = slot.value;
+        slot.sequence.store(pos + Capacity, std::memory_order_release);
+        tail.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Approximate - only meaningful as a statistic
+    size_t getNumReady() const
+    {
+        const size_t h = head.load(std::memory_order_relaxed);
+        const size_t t = tail.load(std::memory_order_relaxed);
+        return h > t ? h - t : 0;
+    }
+
+    static constexpr size_t getCapacity() { return Capacity; }
+
+private:
+    struct Slot
+    {
+        std::atomic<size_t> sequence{ 0 };
+        T value{};
+    };
+
+    static constexpr size_t mask = Capacity - 1;
+
+    std::array<Slot, Capacity> slots;
+    alignas(64) std::atomic<size_t> head{ 0 };
+    alignas(64) std::atomic<size_t> tail{ 0 };
+};
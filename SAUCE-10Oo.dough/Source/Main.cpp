@@ -1,5 +1,7 @@
 #include <JuceHeader.h>
 #include "SAUCE10oOdough.h"
+#include "GuiRenderBenchmark.h"
+#include "EngineScalingBenchmark.h"
 
 //==============================================================================
 class MainWindow : public juce::DocumentWindow
@@ -40,6 +42,22 @@ public:
 
     void initialise(const juce::String& commandLine) override
     {
+        // Headless paint timings - no window is created, so no display server is needed
+        if (commandLine.contains("--benchmark-gui"))
+        {
+            GuiRenderBenchmark::run(std::cout);
+            quit();
+            return;
+        }
+
+        // Sharded pedal engine throughput against thread count, also headless
+        if (commandLine.contains("--benchmark-engine"))
+        {
+            EngineScalingBenchmark::run(std::cout);
+            quit();
+            return;
+        }
+
         mainWindow.reset(new MainWindow(getApplicationName()));
     }
 
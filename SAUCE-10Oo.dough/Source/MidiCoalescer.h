@@ -0,0 +1,161 @@
+#pragma once
+#include "IngressSequencer.h"
+
+// Latest-value coalescing for a batch of non-critical messages.
+// Within a run of continuous data only the newest value per (channel, controller), per channel
+// for pitch bend and channel pressure, and per (channel, note) for poly aftertouch survives.
+// Runs are split by barriers - a gap in the ingress sequence (something was handled on the
+// real-time lane in between) or any message that is not plain continuous data - so nothing
+// moves across a note, a switch pedal, an RPN/NRPN sequence or a program change.
+class MidiCoalescer
+{
+    static constexpr int CC_BASE = 0;
+    static constexpr int PITCH_BEND_BASE = CC_BASE + 16 * 128;
+    static constexpr int CHANNEL_PRESSURE_BASE = PITCH_BEND_BASE + 16;
+    static constexpr int POLY_PRESSURE_BASE = CHANNEL_PRESSURE_BASE + 16;
+
+public:
+    static constexpr int NUM_KEYS = POLY_PRESSURE_BASE + 16 * 128;
+
+    MidiCoalescer()
+    {
+        coalesced.reserve(INITIAL_CAPACITY);
+        std::fill(std::begin(slotGeneration), std::end(slotGeneration), 0u);
+    }
+
+    // Coalesce a batch; the result stays valid until the next call
+    const std::vector<PackedMidiEvent>& process(const std::vector<SequencedMidiEvent>& batch)
+    {
+        coalesced.clear();
+        nextGeneration();
+
+        uint32_t expectedSequence = batch.empty() ? 0 : batch.front().sequence;
+
+        for (const auto& event : batch)
+        {
+            // Unsigned comparison so the sequence counter may wrap
+            if (event.sequence != expectedSequence)
+                nextGeneration();
+
+            expectedSequence = event.sequence + 1;
+
+            const int key = getKey(event.event);
+
+            if (key < 0)
+            {
+                // Barrier: keep it and start a new run after it
+                coalesced.push_back(event.event);
+                nextGeneration();
+                continue;
+            }
+
+            if (slotGeneration[key] == generation)
+            {
+                // Newer value for something already in this run - overwrite it in place
+                coalesced[slotIndex[key]] = event.event;
+                droppedCount.fetch_add(1, std::memory_order_relaxed);
+            }
+            else
+            {
+                slotGeneration[key] = generation;
+                slotIndex[key] = static_cast<int>(coalesced.size());
+                coalesced.push_back(event.event);
+            }
+        }
+
+        return coalesced;
+    }
+
+    // The same rules applied to the deferred lane itself, in place and keeping sequence numbers.
+    // A replaced value stays at its first position, exactly as process() would emit it.
+    void compact(std::vector<SequencedMidiEvent>& lane)
+    {
+        nextGeneration();
+
+        size_t write = 0;
+        uint32_t expectedSequence = lane.empty() ? 0 : lane.front().sequence;
+
+        for (size_t read = 0; read < lane.size(); ++read)
+        {
+            const auto event = lane[read];
+
+            if (event.sequence != expectedSequence)
+                nextGeneration();
+
+            expectedSequence = event.sequence + 1;
+
+            const int key = getKey(event.event);
+
+            if (key < 0)
+            {
+                lane[write++] = event;
+                nextGeneration();
+            }
+            else if (slotGeneration[key] == generation)
+            {
+                // The older entry keeps its place and sequence; the gap left behind only makes a
+                // later pass start a new run there
+                lane[static_cast<size_t>(slotIndex[key])].event = event.event;
+                droppedCount.fetch_add(1, std::memory_order_relaxed);
+            }
+            else
+            {
+                slotGeneration[key] = generation;
+                slotIndex[key] = static_cast<int>(write);
+                lane[write++] = event;
+            }
+        }
+
+        lane.resize(write);
+    }
+
+    // Messages removed so far, safe to read from any thread
+    int64_t getDroppedCount() const { return droppedCount.load(std::memory_order_relaxed); }
+
+    // Slot for a coalescable message (below NUM_KEYS), or -1 for anything that must be kept as-is
+    static int getKey(const PackedMidiEvent& event)
+    {
+        if (event.getStatus() >= 0xf0)
+            return -1;
+
+        const int channel = event.getChannel() - 1;
+
+        switch (event.getType())
+        {
+            case 0xb0: return isContinuousController(event.getData1()) ? CC_BASE + channel * 128 + event.getData1() : -1;
+            case 0xe0: return PITCH_BEND_BASE + channel;
+            case 0xd0: return CHANNEL_PRESSURE_BASE + channel;
+            case 0xa0: return POLY_PRESSURE_BASE + channel * 128 + event.getData1();
+            default:   return -1;
+        }
+    }
+
+private:
+    // Controllers where only the latest value matters
+    static bool isContinuousController(int cc)
+    {
+        return !((cc >= 64 && cc <= 69)      // Switch pedals - every transition counts
+            || cc == 6 || cc == 38           // Data entry belongs to the RPN/NRPN selected before it
+            || (cc >= 96 && cc <= 101)       // Data increment/decrement and RPN/NRPN select
+            || cc >= 120);                   // Channel mode messages
+    }
+
+    void nextGeneration()
+    {
+        // On wrap-around, forget every slot rather than risk matching a stale generation
+        if (++generation == 0)
+        {
+            std::fill(std::begin(slotGeneration), std::end(slotGeneration), 0u);
+            generation = 1;
+        }
+    }
+
+    //==============================================================================
+    static constexpr size_t INITIAL_CAPACITY = 1024;
+
+    std::vector<PackedMidiEvent> coalesced;
+    uint32_t generation = 0;
+    uint32_t slotGeneration[NUM_KEYS];
+    int slotIndex[NUM_KEYS] = {};
+    std::atomic<int64_t> droppedCount{ 0 };
+};
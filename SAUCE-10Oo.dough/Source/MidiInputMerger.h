@@ -0,0 +1,166 @@
+#pragma once
+#include "LockFreeMpscQueue.h"
+#include "PackedMidiEvent.h"
+#include "SysExStreamer.h"
+
+// Merges several MIDI inputs (a keyboard and a separate pedal controller, say) into one
+// stream for the engine, without an external merger.
+//
+// Each input's callback pushes into that input's own ring - no lock, nothing shared with the
+// other inputs. A single thread drains the rings with a k-way merge: it keeps the oldest
+// unprocessed event of every input and always hands on the one with the earliest timestamp,
+// so a pedal press and a note played a moment apart on two devices reach the engine in the
+// order they were played. Events are merged as soon as they are available; an input's own
+// events always keep their order. Each event carries the index of its input for logging.
+// UMP input has a ring of its own, so MIDI 2.0 values reach the engine on the same thread,
+// and so do the owner's own commands (on-screen playing, a panic): the merge thread is then
+// the only one that ever runs the engine.
+class MidiInputMerger : private juce::Thread
+{
+public:
+    static constexpr int MAX_INPUTS = 8;
+    static constexpr int UMP_INPUT = MAX_INPUTS;         // The ring UMP packets arrive through
+    static constexpr int COMMAND_INPUT = MAX_INPUTS + 1; // The ring the owner's commands arrive through
+
+    struct Item
+    {
+        PackedMidiEvent event;
+        uint8_t input = 0;
+        SysExStreamer::Dump sysex; // A complete dump its callback has written into the arena
+        uint32_t fullValue = 0;    // A UMP packet's MIDI 2.0 value, if hasFullValue
+        bool hasFullValue = false;
+        uint8_t command = 0;       // What the owner asked for, on the command ring
+    };
+
+    // Whoever processes the merged stream, on the merge thread
+    class Consumer
+    {
+    public:
+        virtual ~Consumer() = default;
+        virtual void processMergedEvent(const Item& item) = 0;
+    };
+
+    MidiInputMerger(Consumer& consumerToUse)
+        : juce::Thread("MIDI Input Merge"),
+        consumer(consumerToUse)
+    {
+    }
+
+    ~MidiInputMerger() override
+    {
+        stop();
+    }
+
+    void start() { startThread(juce::Thread::Priority::highest); }
+
+    void stop()
+    {
+        signalThreadShouldExit();
+        wakeUp.signal();
+        stopThread(2000);
+    }
+
+    // Called only from the callback of `input`. Returns false if its ring is full (the merge
+    // thread has stalled), in which case the event is lost - and a dump stays the caller's.
+    bool push(int input, const PackedMidiEvent& event, const SysExStreamer::Dump& sysex = {})
+    {
+        return pushItem({ event, static_cast<uint8_t>(input), sysex });
+    }
+
+    // A UMP packet, with the value it carried at full resolution
+    bool pushUmp(const PackedMidiEvent& event, uint32_t fullValue, bool hasFullValue)
+    {
+        return pushItem({ event, static_cast<uint8_t>(UMP_INPUT), {}, fullValue, hasFullValue });
+    }
+
+    // From any of the owner's threads: work the merge thread is to do in its place, in timestamp
+    // order with the inputs. The event carries the command's data and its timestamp.
+    bool pushCommand(uint8_t command, const PackedMidiEvent& event)
+    {
+        return pushItem({ event, static_cast<uint8_t>(COMMAND_INPUT), {}, 0, false, command });
+    }
+
+    int64_t getDroppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t RING_CAPACITY = 1024;
+    static constexpr int IDLE_WAIT_MS = 100;
+    static constexpr int NUM_RINGS = MAX_INPUTS + 2;
+
+    bool pushItem(const Item& item)
+    {
+        if (!rings[item.input].push(item))
+        {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        // Pairs with the fence in run(): either the merge thread sees this event before parking,
+        // or this sees it parked and wakes it
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (parked.load(std::memory_order_relaxed))
+            wakeUp.signal();
+
+        return true;
+    }
+
+    void run() override
+    {
+        while (!threadShouldExit())
+        {
+            drain();
+
+            parked.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if (!isAnyReady())
+                wakeUp.wait(IDLE_WAIT_MS);
+
+            parked.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    // Merge everything available, including what arrives meanwhile
+    void drain()
+    {
+        for (;;)
+        {
+            int earliest = -1;
+
+            for (int i = 0; i < NUM_RINGS; ++i)
+            {
+                if (!hasHead[i])
+                    hasHead[i] = rings[i].pop(heads[i]);
+
+                // Tick differences are wrap-safe
+                if (hasHead[i] && (earliest < 0 || static_cast<int32_t>(heads[i].event.tick - heads[earliest].event.tick) < 0))
+                    earliest = i;
+            }
+
+            if (earliest < 0)
+                return;
+
+            consumer.processMergedEvent(heads[earliest]);
+            hasHead[earliest] = false;
+        }
+    }
+
+    bool isAnyReady() const
+    {
+        for (const auto& ring : rings)
+            if (ring.getNumReady() > 0)
+                return true;
+
+        return false;
+    }
+
+    //==============================================================================
+    Consumer& consumer;
+    LockFreeMpscQueue<Item, RING_CAPACITY> rings[NUM_RINGS];
+    Item heads[NUM_RINGS];        // Oldest unprocessed event of each ring (merge thread only)
+    bool hasHead[NUM_RINGS] = {};
+    std::atomic<bool> parked{ false };
+    juce::WaitableEvent wakeUp;
+    std::atomic<int64_t> dropped{ 0 };
+};
@@ -0,0 +1,51 @@
+#pragma once
+#include "PackedMidiEvent.h"
+
+// Prepares outgoing messages for a 5-pin DIN / serial MIDI link.
+// JUCE outputs take whole messages, so the running status itself is applied by the interface
+// (every DIN interface's UART firmware does). What we can do is help it: sending note-offs as
+// zero-velocity note-ons keeps the status byte constant across a release burst, so the
+// interface can leave it out. That only pays on a byte-stream link - on USB every message is a
+// fixed-size packet and the rewrite would just lose the release velocity - so it only applies
+// while the link model is one. The encoder also counts the bytes handed to the outputs.
+class MidiWireEncoder
+{
+public:
+    static constexpr double DIN_BAUD_RATE = 31250.0;
+    static constexpr double DIN_BITS_PER_BYTE = 10.0; // Start + 8 data + stop
+
+    void setRunningStatusEnabled(bool shouldBeEnabled) { runningStatusEnabled.store(shouldBeEnabled, std::memory_order_relaxed); }
+    bool isRunningStatusEnabled() const { return runningStatusEnabled.load(std::memory_order_relaxed); }
+
+    // Whether the output link model is a byte stream (DIN) rather than packets (USB)
+    void setByteStreamLink(bool isByteStream) { byteStreamLink.store(isByteStream, std::memory_order_relaxed); }
+
+    // Note-off (0x8n) becomes note-on velocity 0 (0x9n) when running status is enabled on a
+    // byte-stream link. The release velocity is lost, which no receiver we target cares about.
+    PackedMidiEvent prepare(const PackedMidiEvent& e) const
+    {
+        if (isRunningStatusEnabled() && byteStreamLink.load(std::memory_order_relaxed) && e.getType() == 0x80)
+            return PackedMidiEvent::make(e.getStatus() | 0x10, e.getData1(), 0, e.tick);
+
+        return e;
+    }
+
+    // Called for every message (or piece of SysEx) handed to the outputs
+    void count(int numBytes)
+    {
+        bytes.fetch_add(juce::jmax(0, numBytes), std::memory_order_relaxed);
+    }
+
+    // Statistics, safe to read from any thread
+    int64_t getBytes() const { return bytes.load(std::memory_order_relaxed); }
+
+    static double getDinWireTimeMs(int64_t numBytes)
+    {
+        return static_cast<double>(numBytes) * DIN_BITS_PER_BYTE * 1000.0 / DIN_BAUD_RATE;
+    }
+
+private:
+    std::atomic<bool> runningStatusEnabled{ false };
+    std::atomic<bool> byteStreamLink{ false };
+    std::atomic<int64_t> bytes{ 0 };
+};
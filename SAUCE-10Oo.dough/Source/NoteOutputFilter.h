@@ -0,0 +1,66 @@
+#pragma once
+#include "OutputLedger.h"
+
+// Last check before a note reaches the device, against what is actually sounding there - as
+// the output ledger records it, one bit per key. That is the model of the synths we target,
+// where one note-off ends every voice on its key:
+//
+//   note-off, key silent   -> dropped, there is nothing to end
+//   note-on,  key sounding -> a re-strike (typically of a note a pedal is holding). Passed on,
+//                             stacking a voice, or - with retrigger on - preceded by a note-off,
+//                             so the synth ends the old voice instead of piling up another
+//   note-off, key sounding -> passed on, the key is silent again; a second note-off for a
+//                             stacked re-strike finds it silent and is dropped
+//
+// Keeps no key state of its own; the owner calls it under the output lock that guards the
+// ledger, and updates the ledger with whatever it then writes. Statistics may be read anywhere.
+class NoteOutputFilter
+{
+public:
+    enum class Action
+    {
+        pass,      // Write the event
+        drop,      // Redundant - write nothing
+        retrigger  // Write a note-off for the same key first, then the event
+    };
+
+    void setRetriggerEnabled(bool shouldRetrigger) { retrigger.store(shouldRetrigger, std::memory_order_relaxed); }
+    bool isRetriggerEnabled() const { return retrigger.load(std::memory_order_relaxed); }
+
+    Action process(const PackedMidiEvent& e, const OutputLedger& ledger)
+    {
+        if (!e.isNoteOnOrOff())
+            return Action::pass;
+
+        if (!ledger.isSounding(e.getChannel(), e.getData1()))
+        {
+            if (e.isNoteOn())
+                return Action::pass;
+
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return Action::drop;
+        }
+
+        if (e.isNoteOff())
+            return Action::pass;
+
+        if (isRetriggerEnabled())
+        {
+            retriggered.fetch_add(1, std::memory_order_relaxed);
+            return Action::retrigger;
+        }
+
+        stacked.fetch_add(1, std::memory_order_relaxed);
+        return Action::pass;
+    }
+
+    int64_t getDroppedCount() const { return dropped.load(std::memory_order_relaxed); }
+    int64_t getRetriggeredCount() const { return retriggered.load(std::memory_order_relaxed); }
+    int64_t getStackedCount() const { return stacked.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<bool> retrigger{ false };
+    std::atomic<int64_t> dropped{ 0 };
+    std::atomic<int64_t> retriggered{ 0 };
+    std::atomic<int64_t> stacked{ 0 };
+};
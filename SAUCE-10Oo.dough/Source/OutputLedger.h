@@ -0,0 +1,108 @@
+#pragma once
+#include "PackedMidiEvent.h"
+
+// What the app has actually left sounding on the output: one bit per channel and note,
+// updated at the device boundary for every note-on and note-off written. Silencing the output
+// (panic, device switch, shutdown) then costs one note-off per set bit - found by trailing-zero
+// scans - instead of 2048 blind note-offs or an All Notes Off on every channel.
+//
+// Not thread-safe; the owner updates and scans it under its output lock. The count alone may
+// be read from anywhere.
+class OutputLedger
+{
+public:
+    static constexpr int NUM_CHANNELS = 16;
+
+    void update(const PackedMidiEvent& e)
+    {
+        if (!e.isNoteOnOrOff())
+            return;
+
+        const int c = e.getChannel() - 1;
+        const int note = e.getData1();
+        auto& word = sounding[c][note >> 6];
+        const uint64_t bit = 1ULL << (note & 63);
+        const bool wasSounding = (word & bit) != 0;
+
+        if (e.isNoteOn() && !wasSounding)
+        {
+            word |= bit;
+            numSounding.fetch_add(1, std::memory_order_relaxed);
+        }
+        else if (e.isNoteOff() && wasSounding)
+        {
+            word &= ~bit;
+            numSounding.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    bool isSounding(int channel, int note) const
+    {
+        return (sounding[(channel - 1) & 0x0f][(note >> 6) & 1] >> (note & 63) & 1) != 0;
+    }
+
+    // Forget every sounding note, calling fn(channel, note) for each. fn may write to the
+    // output (and so call update) - it works from a snapshot.
+    template <typename Fn>
+    void releaseAll(Fn&& fn)
+    {
+        uint64_t snapshot[NUM_CHANNELS][2];
+        std::memcpy(snapshot, sounding, sizeof(snapshot));
+        clear();
+
+        for (int c = 0; c < NUM_CHANNELS; ++c)
+        {
+            for (int k = 0; k < 2; ++k)
+            {
+                for (uint64_t bits = snapshot[c][k]; bits != 0; bits &= bits - 1)
+                    fn(c + 1, k * 64 + countTrailingZeros(bits));
+            }
+        }
+    }
+
+    // Call fn(channel, note) for each sounding note on the channels in the mask (bit 0 is
+    // channel 1), without forgetting any
+    template <typename Fn>
+    void forEachSounding(uint16_t channels, Fn&& fn) const
+    {
+        for (int c = 0; c < NUM_CHANNELS; ++c)
+        {
+            if (((channels >> c) & 1) == 0)
+                continue;
+
+            for (int k = 0; k < 2; ++k)
+            {
+                for (uint64_t bits = sounding[c][k]; bits != 0; bits &= bits - 1)
+                    fn(c + 1, k * 64 + countTrailingZeros(bits));
+            }
+        }
+    }
+
+    void clear()
+    {
+        std::memset(sounding, 0, sizeof(sounding));
+        numSounding.store(0, std::memory_order_relaxed);
+    }
+
+    int getNumSounding() const { return numSounding.load(std::memory_order_relaxed); }
+
+private:
+    static int countTrailingZeros(uint64_t x)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, x);
+        return static_cast<int>(index);
+#elif defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctzll(x);
+#else
+        int count = 0;
+        while ((x & 1) == 0) { x >>= 1; ++count; }
+        return count;
+#endif
+    }
+
+    //==============================================================================
+    uint64_t sounding[NUM_CHANNELS][2] = {};
+    std::atomic<int> numSounding{ 0 };
+};
@@ -0,0 +1,511 @@
+#pragma once
+#include "PackedMidiEvent.h"
+#include "SysExStreamer.h"
+
+// Fans the processed stream out to several MIDI outputs at once - a hardware synth, a recorder
+// and a software instrument, say - each with its own channel filter (the routing matrix:
+// destinations x 16 channels). Channel-less messages (SysEx, system common and real-time) go to
+// every destination.
+//
+// Every destination has its own ring and its own writer thread, so the only thing the scheduler
+// thread does per destination is copy a few bytes into a ring. A slow or blocked device backs up
+// its own ring; it never delays the others.
+//
+// write(), writeSysEx(), attach() and detach() must be serialised by the owner (its output lock).
+// Destroying a detached destination waits for its queue to drain, so do that outside the lock.
+class OutputRouter
+{
+public:
+    static constexpr int MAX_DESTINATIONS = 4;
+    static constexpr uint16_t ALL_CHANNELS = 0xffff;
+
+    class Destination : private juce::Thread
+    {
+    public:
+        // Opens the device; check isOpen()
+        Destination(const juce::MidiDeviceInfo& deviceInfo, uint16_t channelsToSend)
+            : juce::Thread("MIDI Output " + deviceInfo.name),
+            info(deviceInfo),
+            device(juce::MidiOutput::openDevice(deviceInfo.identifier)),
+            channels(channelsToSend),
+            ring(RING_BYTES)
+        {
+            if (device != nullptr)
+                startThread(juce::Thread::Priority::high);
+        }
+
+        // Writes whatever is still queued, then closes the device
+        ~Destination() override
+        {
+            signalThreadShouldExit();
+            wakeUp.signal();
+            stopThread(2000);
+        }
+
+        bool isOpen() const { return device != nullptr; }
+        const juce::MidiDeviceInfo& getInfo() const { return info; }
+
+        uint16_t getChannels() const { return channels.load(std::memory_order_relaxed); }
+        void setChannels(uint16_t mask) { channels.store(mask, std::memory_order_relaxed); }
+
+        bool accepts(const PackedMidiEvent& event) const
+        {
+            const int channel = event.getChannel();
+            return channel == 0 || ((getChannels() >> (channel - 1)) & 1) != 0;
+        }
+
+        // Queue one short message. While the ring is full, note-offs and the latest value of each
+        // controller, pitch bend, pressure and program are kept back and written once the device
+        // has caught up - a backed-up device still ends with no hanging notes and no stale
+        // values. Note-ons and anything else are dropped.
+        void push(const PackedMidiEvent& event)
+        {
+            {
+                const juce::SpinLock::ScopedLockType sl(owedLock);
+
+                const uint8_t raw[3] = { event.getStatus(), static_cast<uint8_t>(event.getData1()), static_cast<uint8_t>(event.getData2()) };
+
+                // Nothing may overtake what is owed, so the ring waits until that has gone
+                if (numOwed > 0 || !pushRecord(raw, event.getSize()))
+                    owe(event);
+            }
+
+            signalWriter();
+        }
+
+        // Whether the next piece of a dump fits now
+        bool hasRoomForSysEx(int size) const
+        {
+            return !isOwing() && getFreeBytes() >= static_cast<size_t>(size + (size / MAX_RECORD_BYTES + 1) * HEADER_BYTES);
+        }
+
+        // A device that has been inside one write for a while is not coming back soon
+        bool isStalled() const
+        {
+            const double since = sendingSince.load(std::memory_order_relaxed);
+            return since > 0 && juce::Time::getMillisecondCounterHiRes() - since > STALL_MS;
+        }
+
+        // The next piece of a dump. The writer collects the pieces and gives the device the whole
+        // message once the piece ending in F7 arrives. A piece that does not fit drops the rest of
+        // that dump here, so the device never sees part of it.
+        void pushSysEx(const uint8_t* data, int size)
+        {
+            if (data[0] == 0xf0)
+                isDumpBroken = false;
+
+            if (isDumpBroken)
+                return;
+
+            if (!hasRoomForSysEx(size))
+            {
+                isDumpBroken = true;
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            for (int offset = 0; offset < size; offset += MAX_RECORD_BYTES)
+                pushRecord(data + offset, juce::jmin(MAX_RECORD_BYTES, size - offset));
+
+            signalWriter();
+        }
+
+        int64_t getDroppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+    private:
+        static constexpr size_t RING_BYTES = 1 << 16;
+        static constexpr int HEADER_BYTES = 2; // Record length, little-endian
+        static constexpr int MAX_RECORD_BYTES = 1024;
+        // The largest dump the scheduler's arena can hold, and so the largest one sent
+        static constexpr int MAX_DUMP_BYTES = SysExStreamer::NUM_BLOCKS * SysExStreamer::CHUNK_BYTES;
+        static constexpr double STALL_MS = 250.0;
+        static constexpr int IDLE_WAIT_MS = 100;
+
+        // Latest-value slots for owed messages: controllers, then pitch bend, channel pressure
+        // and program per channel, then poly pressure
+        static constexpr int PITCH_BEND_KEY = 16 * 128;
+        static constexpr int CHANNEL_PRESSURE_KEY = PITCH_BEND_KEY + 16;
+        static constexpr int PROGRAM_KEY = CHANNEL_PRESSURE_KEY + 16;
+        static constexpr int POLY_PRESSURE_KEY = PROGRAM_KEY + 16;
+        static constexpr int NUM_VALUE_KEYS = POLY_PRESSURE_KEY + 16 * 128;
+        static constexpr int NUM_VALUE_WORDS = (NUM_VALUE_KEYS + 63) / 64;
+
+        static int getValueKey(const PackedMidiEvent& event)
+        {
+            const int c = event.getChannel() - 1;
+
+            switch (event.getType())
+            {
+                case 0xb0:
+                {
+                    // Data entry and RPN/NRPN selection only mean something in sequence
+                    const int cc = event.getData1();
+                    return (cc == 6 || cc == 38 || (cc >= 96 && cc <= 101)) ? -1 : c * 128 + cc;
+                }
+
+                case 0xe0: return PITCH_BEND_KEY + c;
+                case 0xd0: return CHANNEL_PRESSURE_KEY + c;
+                case 0xc0: return PROGRAM_KEY + c;
+                case 0xa0: return POLY_PRESSURE_KEY + c * 128 + event.getData1();
+                default:   return -1;
+            }
+        }
+
+        //==============================================================================
+        // Producer side, under owedLock
+        void owe(const PackedMidiEvent& event)
+        {
+            if (event.isNoteOff())
+            {
+                auto& word = owedNoteOffs[event.getChannel() - 1][event.getData1() >> 6];
+                const uint64_t bit = 1ULL << (event.getData1() & 63);
+                numOwed += (word & bit) == 0 ? 1 : 0;
+                word |= bit;
+                return;
+            }
+
+            const int key = event.getStatus() < 0xf0 ? getValueKey(event) : -1;
+
+            if (key < 0)
+            {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            auto& word = owedValueBits[key >> 6];
+            const uint64_t bit = 1ULL << (key & 63);
+            numOwed += (word & bit) == 0 ? 1 : 0;
+            word |= bit;
+            owedValues[key] = event; // Newest wins
+        }
+
+        bool isOwing() const
+        {
+            const juce::SpinLock::ScopedLockType sl(owedLock);
+            return numOwed > 0;
+        }
+
+        // Writer side: take one owed message. Note-offs go first, so a pedal press owed after one
+        // cannot catch its note.
+        bool takeOwed(PackedMidiEvent& event)
+        {
+            const juce::SpinLock::ScopedLockType sl(owedLock);
+
+            if (numOwed == 0)
+                return false;
+
+            for (int c = 0; c < 16; ++c)
+            {
+                for (int k = 0; k < 2; ++k)
+                {
+                    if (owedNoteOffs[c][k] != 0)
+                    {
+                        const int note = k * 64 + countTrailingZeros(owedNoteOffs[c][k]);
+                        owedNoteOffs[c][k] &= owedNoteOffs[c][k] - 1;
+                        event = PackedMidiEvent::noteOff(c + 1, note, 0);
+                        --numOwed;
+                        return true;
+                    }
+                }
+            }
+
+            for (int w = 0; w < NUM_VALUE_WORDS; ++w)
+            {
+                if (owedValueBits[w] != 0)
+                {
+                    const int key = w * 64 + countTrailingZeros(owedValueBits[w]);
+                    owedValueBits[w] &= owedValueBits[w] - 1;
+                    event = owedValues[key];
+                    --numOwed;
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        //==============================================================================
+        // Single-producer / single-consumer byte ring of length-prefixed records
+        size_t getFreeBytes() const
+        {
+            return RING_BYTES - (writePos.load(std::memory_order_relaxed) - readPos.load(std::memory_order_acquire));
+        }
+
+        bool pushRecord(const uint8_t* data, int size)
+        {
+            if (getFreeBytes() < static_cast<size_t>(size + HEADER_BYTES))
+                return false;
+
+            const uint8_t header[HEADER_BYTES] = { static_cast<uint8_t>(size), static_cast<uint8_t>(size >> 8) };
+            const size_t pos = writePos.load(std::memory_order_relaxed);
+            copyIn(pos, header, HEADER_BYTES);
+            copyIn(pos + HEADER_BYTES, data, size);
+            writePos.store(pos + HEADER_BYTES + static_cast<size_t>(size), std::memory_order_release);
+            return true;
+        }
+
+        void copyIn(size_t pos, const uint8_t* data, int size)
+        {
+            const size_t start = pos & (RING_BYTES - 1);
+            const size_t first = juce::jmin(static_cast<size_t>(size), RING_BYTES - start);
+            std::memcpy(ring.data() + start, data, first);
+            std::memcpy(ring.data(), data + first, static_cast<size_t>(size) - first);
+        }
+
+        void copyOut(size_t pos, uint8_t* data, int size) const
+        {
+            const size_t start = pos & (RING_BYTES - 1);
+            const size_t first = juce::jmin(static_cast<size_t>(size), RING_BYTES - start);
+            std::memcpy(data, ring.data() + start, first);
+            std::memcpy(data + first, ring.data(), static_cast<size_t>(size) - first);
+        }
+
+        bool popRecord(uint8_t* data, int& size)
+        {
+            const size_t pos = readPos.load(std::memory_order_relaxed);
+
+            if (writePos.load(std::memory_order_acquire) == pos)
+                return false;
+
+            uint8_t header[HEADER_BYTES];
+            copyOut(pos, header, HEADER_BYTES);
+            size = header[0] | header[1] << 8;
+            copyOut(pos + HEADER_BYTES, data, size);
+            readPos.store(pos + HEADER_BYTES + static_cast<size_t>(size), std::memory_order_release);
+            return true;
+        }
+
+        void signalWriter()
+        {
+            // Pairs with the fence in run(), as in MidiInputMerger::push()
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if (parked.load(std::memory_order_relaxed))
+                wakeUp.signal();
+        }
+
+        //==============================================================================
+        void run() override
+        {
+            uint8_t record[MAX_RECORD_BYTES];
+
+            for (;;)
+            {
+                int size = 0;
+                while (popRecord(record, size))
+                    handleRecord(record, size);
+
+                // The ring is empty, and stays so until everything owed has gone
+                PackedMidiEvent owed;
+                if (takeOwed(owed))
+                {
+                    const uint8_t raw[3] = { owed.getStatus(), static_cast<uint8_t>(owed.getData1()), static_cast<uint8_t>(owed.getData2()) };
+                    send(juce::MidiMessage(raw, owed.getSize(), 0.0));
+                    continue;
+                }
+
+                if (threadShouldExit())
+                    return;
+
+                parked.store(true, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+
+                if (writePos.load(std::memory_order_acquire) == readPos.load(std::memory_order_relaxed) && !isOwing())
+                    wakeUp.wait(IDLE_WAIT_MS);
+
+                parked.store(false, std::memory_order_relaxed);
+            }
+        }
+
+        void handleRecord(const uint8_t* data, int size)
+        {
+            const uint8_t first = data[0];
+
+            // A short message: at most three bytes, so MidiMessage keeps it inline
+            if (first >= 0x80 && first != 0xf0 && first != 0xf7)
+            {
+                send(juce::MidiMessage(data, size, 0.0));
+                return;
+            }
+
+            // A piece of a dump. One that continues a dump whose start was dropped is dropped too.
+            if (first == 0xf0)
+            {
+                // Sized once, for the largest dump there can be, on this destination's first one
+                if (dump.empty())
+                    dump.resize(MAX_DUMP_BYTES);
+
+                dumpSize = 0;
+            }
+            else if (dumpSize == 0)
+            {
+                return;
+            }
+
+            if (dumpSize + size > MAX_DUMP_BYTES)
+            {
+                dumpSize = 0;
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            std::memcpy(dump.data() + dumpSize, data, static_cast<size_t>(size));
+            dumpSize += size;
+
+            if (data[size - 1] == 0xf7)
+            {
+                // JUCE only sends a dump as one MidiMessage, which copies it to the heap: the
+                // one allocation a dump costs, made here on the writer thread
+                send(juce::MidiMessage(dump.data(), dumpSize, 0.0));
+                dumpSize = 0;
+            }
+        }
+
+        void send(const juce::MidiMessage& message)
+        {
+            sendingSince.store(juce::Time::getMillisecondCounterHiRes(), std::memory_order_relaxed);
+            device->sendMessageNow(message);
+            sendingSince.store(0, std::memory_order_relaxed);
+        }
+
+        static int countTrailingZeros(uint64_t x)
+        {
+#if defined(_MSC_VER)
+            unsigned long index;
+            _BitScanForward64(&index, x);
+            return static_cast<int>(index);
+#elif defined(__GNUC__) || defined(__clang__)
+            return __builtin_ctzll(x);
+#else
+            int count = 0;
+            while ((x & 1) == 0) { x >>= 1; ++count; }
+            return count;
+#endif
+        }
+
+        //==============================================================================
+        const juce::MidiDeviceInfo info;
+        std::unique_ptr<juce::MidiOutput> device;
+        std::atomic<uint16_t> channels;
+
+        std::vector<uint8_t> ring; // RING_BYTES, allocated once
+        std::atomic<size_t> writePos{ 0 };
+        std::atomic<size_t> readPos{ 0 };
+        std::atomic<bool> parked{ false };
+        juce::WaitableEvent wakeUp;
+
+        // Held back while the ring was full, written once it has drained
+        mutable juce::SpinLock owedLock;
+        int numOwed = 0;
+        uint64_t owedNoteOffs[16][2] = {};
+        uint64_t owedValueBits[NUM_VALUE_WORDS] = {};
+        PackedMidiEvent owedValues[NUM_VALUE_KEYS];
+
+        bool isDumpBroken = false; // Producer side
+        std::vector<uint8_t> dump; // Writer side: the dump being collected, MAX_DUMP_BYTES once used
+        int dumpSize = 0;          // Writer side; 0 while no dump is being collected
+        std::atomic<double> sendingSince{ 0 };
+        std::atomic<int64_t> dropped{ 0 };
+    };
+
+    //==============================================================================
+    // Returns nullptr once attached. A destination with no free slot, or whose device did not
+    // open, is handed back - like a detached one, to be destroyed outside the lock.
+    std::unique_ptr<Destination> attach(std::unique_ptr<Destination> destination)
+    {
+        if (destination == nullptr || !destination->isOpen())
+            return destination;
+
+        for (auto& slot : destinations)
+        {
+            if (slot == nullptr)
+            {
+                slot = std::move(destination);
+                return nullptr;
+            }
+        }
+
+        return destination;
+    }
+
+    std::unique_ptr<Destination> detach(const juce::String& identifier)
+    {
+        for (auto& slot : destinations)
+        {
+            if (slot != nullptr && slot->getInfo().identifier == identifier)
+            {
+                dropped.fetch_add(slot->getDroppedCount(), std::memory_order_relaxed);
+                return std::move(slot);
+            }
+        }
+
+        return nullptr;
+    }
+
+    Destination* find(const juce::String& identifier) const
+    {
+        for (const auto& slot : destinations)
+            if (slot != nullptr && slot->getInfo().identifier == identifier)
+                return slot.get();
+
+        return nullptr;
+    }
+
+    bool isFull() const
+    {
+        for (const auto& slot : destinations)
+            if (slot == nullptr)
+                return false;
+
+        return true;
+    }
+
+    // Hand a short message to every destination whose filter lets it through
+    void write(const PackedMidiEvent& event)
+    {
+        for (const auto& slot : destinations)
+            if (slot != nullptr && slot->accepts(event))
+                slot->push(event);
+    }
+
+    // The next piece of a SysEx dump, to every destination. Returns false, queueing nothing,
+    // while a destination that is keeping up has no room for it yet; a stalled one drops the
+    // dump instead of holding everyone's dumps back.
+    bool writeSysEx(const uint8_t* data, int size)
+    {
+        for (const auto& slot : destinations)
+            if (slot != nullptr && !slot->hasRoomForSysEx(size) && !slot->isStalled())
+                return false;
+
+        for (const auto& slot : destinations)
+            if (slot != nullptr)
+                slot->pushSysEx(data, size);
+
+        return true;
+    }
+
+    // Messages (and dumps) lost because a destination could not keep up
+    int64_t getDroppedCount() const
+    {
+        int64_t total = dropped.load(std::memory_order_relaxed);
+        for (const auto& slot : destinations)
+            if (slot != nullptr)
+                total += slot->getDroppedCount();
+
+        return total;
+    }
+
+    juce::StringArray getNames() const
+    {
+        juce::StringArray names;
+        for (const auto& slot : destinations)
+            if (slot != nullptr)
+                names.add(slot->getInfo().name);
+
+        return names;
+    }
+
+private:
+    std::unique_ptr<Destination> destinations[MAX_DESTINATIONS];
+    std::atomic<int64_t> dropped{ 0 }; // Kept across detach, from destinations that are gone
+};
@@ -0,0 +1,718 @@
+#pragma once
+#include "LockFreeMpscQueue.h"
+#include "MidiCoalescer.h"
+#include "SysExStreamer.h"
+#include "PackedMidiEvent.h"
+
+// Paces outgoing messages to the bandwidth of the output link.
+// Note-ons go out first; note-offs and controllers fill whatever capacity is left.
+// A token bucket sized to the device buffer keeps bursts from overflowing it.
+// A note-on only jumps the queue when nothing else on its channel (other than note-offs)
+// is still waiting, so a CC or program change sent before a note still arrives first.
+// System real-time bytes (clock, transport, active sensing) bypass everything: MIDI allows
+// them between any two bytes, so they are written as soon as the thread wakes, with their
+// original timestamps, and never wait for tokens.
+// A SysEx dump is queued once it has arrived complete, so nothing waits for a dump still coming
+// in. Dumps have a lane of their own, served last and only from the tokens every other lane left
+// over, so no note-on, note-off or pedal ever waits behind a dump's bytes or its rate cap. Their
+// bytes go to the sink block by block, a block per pass; the sink hands the device the whole
+// message. Everything queued before a dump still goes out first; what is queued after it may
+// overtake it.
+// Pedal-release note-offs can be spread out: they wait in their own lane until due, so the
+// timing costs the engine nothing beyond enqueueing them.
+// A controller, pitch bend or pressure value still waiting in the bulk lane is overwritten by a
+// newer one for the same slot (MidiCoalescer's rules), as long as nothing else has been queued on
+// its channel since - so a saturated link falls behind by one value per slot between barriers,
+// not by every value sent.
+class OutputScheduler : private juce::Thread
+{
+public:
+    enum Lane
+    {
+        realtimeLane = 0, // System real-time (0xF8-0xFF)
+        criticalLane,     // Note-ons
+        bulkLane,         // Note-offs, controllers, everything else
+        releaseLane,      // Spread pedal-release note-offs, each held until due
+        sysexLane,        // Complete SysEx dumps, on leftover tokens only
+        numLanes
+    };
+
+    // Bandwidth and buffer depth of a physical link
+    struct LinkModel
+    {
+        const char* name;
+        double bytesPerSecond; // <= 0 means unlimited
+        int bucketBytes;
+        bool isByteStream;     // Serial bytes (DIN) rather than whole-message packets (USB)
+    };
+
+    static constexpr LinkModel linkModels[] = {
+        { "USB-MIDI", 100000.0, 512, false },
+        { "5-pin DIN (31.25k)", 3125.0, 32, true },
+        { "Unlimited", 0.0, 0, false }
+    };
+    static constexpr int numLinkModels = 3;
+
+    // Extra cap on SysEx throughput, for receivers that process dumps slower than the link runs.
+    // Devices take a dump as one message, so the cap spaces dumps out: after a dump of n bytes,
+    // the next one waits n / rate seconds.
+    struct SysExRate
+    {
+        const char* name;
+        double bytesPerSecond; // <= 0 means link speed
+    };
+
+    static constexpr SysExRate sysExRates[] = {
+        { "Link speed", 0.0 },
+        { "8 KB/s", 8192.0 },
+        { "2 KB/s", 2048.0 },
+        { "500 B/s", 500.0 }
+    };
+    static constexpr int numSysExRates = 4;
+
+    // Whoever actually writes to the device
+    class Sink
+    {
+    public:
+        virtual ~Sink() = default;
+        // fullValue: the MIDI 2.0 resolution value carried with the event, 0 if none
+        virtual void writeMessage(const PackedMidiEvent& event, uint32_t fullValue) = 0;
+        // The next piece of a dump (the first starts with F0, the last ends with F7). Return false
+        // to have the same piece offered again shortly.
+        virtual bool writeSysEx(const uint8_t* data, int size) = 0;
+    };
+
+    struct LaneStats
+    {
+        int64_t count = 0;
+        double meanDelayMs = 0;
+        double maxDelayMs = 0;
+    };
+
+    // How much the forwarding added to MIDI clock tick spacing
+    struct ClockJitterStats
+    {
+        int64_t ticks = 0;
+        double meanJitterMs = 0;
+        double maxJitterMs = 0;
+    };
+
+    OutputScheduler(Sink& sinkToUse)
+        : juce::Thread("MIDI Output Scheduler"),
+        sink(sinkToUse)
+    {
+        std::fill(std::begin(claimedCells), std::end(claimedCells), -1);
+
+        for (int i = 0; i < NUM_VALUE_CELLS; ++i)
+            freeCells[i] = i;
+
+        numFreeCells = NUM_VALUE_CELLS;
+        setLinkModel(0);
+    }
+
+    ~OutputScheduler() override
+    {
+        stop();
+    }
+
+    void start() { startThread(juce::Thread::Priority::highest); }
+
+    void stop()
+    {
+        signalThreadShouldExit();
+        wakeUp.signal();
+        stopThread(2000);
+    }
+
+    void setLinkModel(int index)
+    {
+        const auto& model = linkModels[juce::jlimit(0, numLinkModels - 1, index)];
+        bytesPerSecond.store(model.bytesPerSecond, std::memory_order_relaxed);
+        bucketBytes.store(model.bucketBytes, std::memory_order_relaxed);
+        byteStream.store(model.isByteStream, std::memory_order_relaxed);
+        wakeUp.signal();
+    }
+
+    bool isByteStreamLink() const { return byteStream.load(std::memory_order_relaxed); }
+
+    void setSysExRate(int index)
+    {
+        sysExBytesPerSecond.store(sysExRates[juce::jlimit(0, numSysExRates - 1, index)].bytesPerSecond, std::memory_order_relaxed);
+        wakeUp.signal();
+    }
+
+    // Safe from any thread. Returns false, queueing nothing, if the lane is full; writing the
+    // message some other way would overtake what is queued, so retry (or use enqueueWaiting).
+    // A note-on may bring the note-off of a voice the polyphony limit ends for it, which goes out
+    // just ahead of it in whichever lane it takes, so the synth never holds one voice too many.
+    bool enqueue(const PackedMidiEvent& event, uint32_t fullValue = 0, const PackedMidiEvent& stolenVoice = {})
+    {
+        const bool isNoteOff = event.isNoteOff();
+        const int channel = event.getStatus() & 0x0f;
+        const int note = event.getData1();
+        const bool isChannelMessage = event.getStatus() < 0xf0;
+
+        Item item{ event, juce::Time::getMillisecondCounterHiRes() };
+        item.fullValue = fullValue;
+        item.order = nextOrder.fetch_add(1, std::memory_order_relaxed);
+        item.stolenVoice = stolenVoice;
+        bool ok = true;
+
+        // Pending like any queued note-off, so a note-on for the stolen key promotes it rather
+        // than overtaking it
+        const bool ownsStolenBit = stolenVoice.isNoteOff()
+            && !markPendingNoteOff(stolenVoice.getStatus() & 0x0f, stolenVoice.getData1());
+
+        if (event.isSystemRealTime())
+        {
+            ok = lanes[realtimeLane].push(item);
+        }
+        else if (event.isNoteOn() && pendingBulkPerChannel[channel].load(std::memory_order_acquire) == 0)
+        {
+            // A note-off for the same key still waiting in the bulk or release lane must not land after
+            // this note-on, or it would cut the new note. The note-on carries it ahead in its own
+            // slot, so the two are queued together or not at all.
+            item.releaseFirst = clearPendingNoteOff(channel, note);
+            ok = lanes[criticalLane].push(item);
+
+            // Not queued: the waiting note-off is the one to send after all
+            if (!ok && item.releaseFirst)
+                markPendingNoteOff(channel, note);
+        }
+        else
+        {
+            // A release still waiting in the release lane must not land after this note-on either;
+            // it is carried the same way
+            if (isNoteOff)
+                markPendingNoteOff(channel, note);
+            else if (event.isNoteOn())
+                item.releaseFirst = clearPendingNoteOff(channel, note);
+
+            // Everything but note-offs holds back later note-ons on the same channel
+            item.holdsChannel = isChannelMessage && !isNoteOff;
+
+            const int valueSlot = MidiCoalescer::getKey(event);
+
+            if (valueSlot >= 0)
+            {
+                ok = pushLatestValue(item, valueSlot);
+            }
+            else
+            {
+                // Nothing queued before it may take a newer value from after it
+                if (isChannelMessage)
+                    barriersPerChannel[channel].fetch_add(1, std::memory_order_acq_rel);
+                else
+                    systemBarriers.fetch_add(1, std::memory_order_acq_rel);
+
+                ok = pushBulk(item);
+            }
+
+            if (!ok && item.releaseFirst)
+                markPendingNoteOff(channel, note);
+        }
+
+        if (!ok && ownsStolenBit)
+            clearPendingNoteOff(stolenVoice.getStatus() & 0x0f, stolenVoice.getData1());
+
+        wakeUp.signal();
+        return ok;
+    }
+
+    // Back-pressure for producers that must neither lose nor reorder anything: waits for the
+    // scheduler to make room. Never call with the sink's lock held - draining takes it.
+    void enqueueWaiting(const PackedMidiEvent& event, uint32_t fullValue = 0, const PackedMidiEvent& stolenVoice = {})
+    {
+        waitFor([&] { return enqueue(event, fullValue, stolenVoice); });
+    }
+
+    void enqueueReleaseWaiting(const PackedMidiEvent& noteOff, double delayMs)
+    {
+        waitFor([&] { return enqueueRelease(noteOff, delayMs); });
+    }
+
+    // A note-off to go out delayMs from now. Calls must come in due order; a later call with an
+    // earlier due time waits behind the earlier ones. A note-on for the same key arriving in the
+    // meantime promotes the note-off ahead of it, as for the bulk lane.
+    bool enqueueRelease(const PackedMidiEvent& noteOff, double delayMs)
+    {
+        Item item{ noteOff, juce::Time::getMillisecondCounterHiRes() };
+        item.dueAt = item.enqueuedAt + delayMs;
+        item.order = nextOrder.fetch_add(1, std::memory_order_relaxed);
+
+        markPendingNoteOff(noteOff.getStatus() & 0x0f, noteOff.getData1());
+        const bool ok = lanes[releaseLane].push(item);
+
+        if (!ok)
+            clearPendingNoteOff(noteOff.getStatus() & 0x0f, noteOff.getData1());
+
+        wakeUp.signal();
+        return ok;
+    }
+
+    // SysEx, written into the arena by its input while it arrives - any number of writers, each
+    // with its own Dump. Returns the number of bytes the arena accepted.
+    int writeSysEx(SysExStreamer::Dump& dump, const uint8_t* data, int size) { return sysex.write(dump, data, size); }
+
+    // A dump that will not be sent (interrupted, or too big for the arena)
+    void discardSysEx(SysExStreamer::Dump& dump) { sysex.discard(dump); }
+
+    // A complete dump goes out after everything enqueued so far, waiting for room in its lane
+    // like enqueueWaiting(). The dump is discarded only if the scheduler has stopped.
+    void enqueueSysExWaiting(SysExStreamer::Dump& dump)
+    {
+        Item item{ PackedMidiEvent::make(0xf0, 0, 0, PackedMidiEvent::ticksNow()), juce::Time::getMillisecondCounterHiRes() };
+        item.sysexBlock = dump.first;
+        item.sysexSize = dump.size;
+
+        bool queued = false;
+
+        if (dump.first != SysExStreamer::NO_BLOCK)
+            waitFor([&] { return queued = lanes[sysexLane].push(item); });
+
+        if (!queued)
+        {
+            sysex.discard(dump);
+            return;
+        }
+
+        dump = {};
+        wakeUp.signal();
+    }
+
+    // For a panic, before silencing the output: every note-on queued so far, and every delayed
+    // release, is dropped instead of sent. On return, any note-on from before the call that did go
+    // out is already in the sink's hands, so the silencing that follows catches it.
+    void discardQueuedNotes()
+    {
+        const juce::SpinLock::ScopedLockType sl(sendLock);
+        discardBefore.store(nextOrder.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        wakeUp.signal();
+    }
+
+    // Queued values overwritten by a newer one, safe to read from any thread
+    int64_t getCoalescedCount() const { return coalescedCount.load(std::memory_order_relaxed); }
+
+    int64_t getSysExBytes() const { return sysex.getBytesSent(); }
+    int64_t getSysExDropped() const { return sysex.getDroppedCount(); }
+
+    LaneStats getStats(Lane lane) const
+    {
+        const auto& s = stats[lane];
+        LaneStats result;
+        result.count = s.count.load(std::memory_order_relaxed);
+        result.maxDelayMs = s.maxDelayUs.load(std::memory_order_relaxed) * 0.001;
+
+        if (result.count > 0)
+            result.meanDelayMs = (double)s.totalDelayUs.load(std::memory_order_relaxed) * 0.001 / (double)result.count;
+
+        return result;
+    }
+
+    ClockJitterStats getClockJitter() const
+    {
+        ClockJitterStats result;
+        result.ticks = clockTicks.load(std::memory_order_relaxed);
+        result.maxJitterMs = maxClockJitterUs.load(std::memory_order_relaxed) * 0.001;
+
+        if (result.ticks > 0)
+            result.meanJitterMs = (double)totalClockJitterUs.load(std::memory_order_relaxed) * 0.001 / (double)result.ticks;
+
+        return result;
+    }
+
+private:
+    struct Item
+    {
+        PackedMidiEvent event;
+        double enqueuedAt = 0; // Milliseconds
+        bool holdsChannel = false; // Counted in pendingBulkPerChannel
+        uint32_t fullValue = 0; // MIDI 2.0 resolution value, when the event came in as UMP
+        double dueAt = 0; // Milliseconds, release lane only
+        bool releaseFirst = false; // Note-on carrying a promoted note-off for its key
+        PackedMidiEvent stolenVoice = {}; // Note-on carrying the note-off of the voice it replaces
+        int sysexBlock = SysExStreamer::NO_BLOCK; // First arena block of a SysEx dump
+        int sysexSize = 0;
+        uint64_t order = 0; // Enqueue order, for discardQueuedNotes()
+        int valueCell = -1; // Sends the newest value in valueCells[] rather than its own
+    };
+
+    // The value a queued bulk-lane item sends, which newer values for its slot may overwrite
+    struct ValueCell
+    {
+        PackedMidiEvent event;
+        uint32_t fullValue = 0;
+        int slot = 0; // MidiCoalescer key
+    };
+
+    struct Stats
+    {
+        std::atomic<int64_t> count{ 0 };
+        std::atomic<int64_t> totalDelayUs{ 0 };
+        std::atomic<int64_t> maxDelayUs{ 0 };
+    };
+
+    void run() override
+    {
+        double lastRefill = juce::Time::getMillisecondCounterHiRes();
+        double tokens = 0;
+        double sysexDueAt = 0;  // When the SysEx rate cap lets the next dump start
+        double sysexTokens = 0; // Leftover tokens set aside for the dump lane
+        Item held[numLanes];
+        bool isHeld[numLanes] = {};
+        int dumpBlock = SysExStreamer::NO_BLOCK; // Next block of the dump being sent
+
+        while (!threadShouldExit())
+        {
+            const double rate = bytesPerSecond.load(std::memory_order_relaxed);
+            const double capacity = bucketBytes.load(std::memory_order_relaxed);
+            const bool unlimited = rate <= 0;
+
+            const double sysexRate = sysExBytesPerSecond.load(std::memory_order_relaxed);
+
+            const double now = juce::Time::getMillisecondCounterHiRes();
+            tokens = juce::jmin(capacity, tokens + (now - lastRefill) * 0.001 * rate);
+            lastRefill = now;
+
+            double bytesNeeded = 0;
+            double msUntilDue = 0;
+            int waitMs = -1; // Set when a dump needs the loop to come round early
+
+            // Real-time lane first, then note-ons: each later lane only gets the tokens the lanes above left over
+            for (int lane = 0; lane < numLanes && bytesNeeded <= 0; ++lane)
+            {
+                for (;;)
+                {
+                    if (!isHeld[lane])
+                    {
+                        if (!lanes[lane].pop(held[lane]))
+                            break;
+
+                        isHeld[lane] = true;
+                    }
+
+                    if (lane == sysexLane)
+                    {
+                        if (dumpBlock == SysExStreamer::NO_BLOCK)
+                        {
+                            if (sysexDueAt > now)
+                            {
+                                msUntilDue = sysexDueAt - now;
+                                break;
+                            }
+
+                            recordDelay(lane, now - held[lane].enqueuedAt);
+                            dumpBlock = held[lane].sysexBlock;
+                        }
+
+                        // Every lane above is empty or waiting on a due time, so whatever is in
+                        // the bucket is left over. A block is saved up for across passes and paid
+                        // in full before it goes, never on credit, so a dump leaves no debt for
+                        // the next note to wait out.
+                        const int blockSize = sysex.getSize(dumpBlock);
+
+                        if (!unlimited)
+                        {
+                            const double take = juce::jmin(tokens, blockSize - sysexTokens);
+                            sysexTokens += take;
+                            tokens -= take;
+
+                            // The bucket holds at most its capacity, so come back when it is full
+                            if (sysexTokens < blockSize)
+                            {
+                                bytesNeeded = juce::jmin(blockSize - sysexTokens, capacity - tokens);
+                                break;
+                            }
+                        }
+
+                        // One block per pass, so real-time bytes and fresh notes get a look-in
+                        if (!sink.writeSysEx(sysex.getData(dumpBlock), blockSize))
+                        {
+                            waitMs = 1; // The outputs are still taking the previous block
+                            break;
+                        }
+
+                        sysexTokens -= unlimited ? 0 : blockSize;
+
+                        const int block = dumpBlock;
+                        dumpBlock = sysex.getNext(block);
+                        sysex.recordSent(blockSize);
+                        sysex.release(block);
+                        waitMs = 0;
+
+                        if (dumpBlock == SysExStreamer::NO_BLOCK)
+                        {
+                            isHeld[lane] = false;
+
+                            if (sysexRate > 0)
+                                sysexDueAt = now + held[lane].sysexSize * 1000.0 / sysexRate;
+                        }
+
+                        break;
+                    }
+
+                    if (lane == releaseLane && held[lane].dueAt > now)
+                    {
+                        msUntilDue = held[lane].dueAt - now;
+                        break;
+                    }
+
+                    // Messages bigger than the bucket go out once it is full and leave it in debt
+                    const double cost = held[lane].event.getSize() + (held[lane].releaseFirst ? 3 : 0)
+                        + (held[lane].stolenVoice.isNoteOff() ? 3 : 0);
+                    const double needed = juce::jmin(cost, capacity);
+
+                    if (!unlimited && lane != realtimeLane && tokens < needed)
+                    {
+                        bytesNeeded = needed - tokens;
+                        break;
+                    }
+
+                    // Checked at send time: a note-on may have promoted this note-off while it waited
+                    if ((lane == bulkLane || lane == releaseLane) && isStaleNoteOff(held[lane].event))
+                    {
+                        isHeld[lane] = false;
+                        continue;
+                    }
+
+                    // Whatever newer value overwrote this one while it waited
+                    if (held[lane].valueCell >= 0)
+                        takeLatestValue(held[lane]);
+
+                    {
+                        // Checked and sent under one lock, so a panic either sees this note sent or
+                        // stops it here
+                        const juce::SpinLock::ScopedLockType sl(sendLock);
+
+                        // Unless a note-on for its key has promoted it since
+                        const auto& stolenVoice = held[lane].stolenVoice;
+                        const bool endsStolenVoice = stolenVoice.isNoteOff() && !isStaleNoteOff(stolenVoice);
+
+                        if (!isDiscarded(lane, held[lane]))
+                        {
+                            tokens -= unlimited ? 0 : cost;
+                            recordDelay(lane, juce::Time::getMillisecondCounterHiRes() - held[lane].enqueuedAt);
+
+                            if (endsStolenVoice)
+                                sink.writeMessage(stolenVoice, 0);
+
+                            if (held[lane].releaseFirst)
+                            {
+                                const auto& e = held[lane].event;
+                                sink.writeMessage(PackedMidiEvent::noteOff(e.getChannel(), e.getData1(), e.tick), 0);
+                            }
+
+                            sink.writeMessage(held[lane].event, held[lane].fullValue);
+                        }
+                    }
+
+                    isHeld[lane] = false;
+
+                    if (lane == realtimeLane && held[lane].event.getStatus() == 0xf8)
+                        recordClockTick(held[lane].event.tick, PackedMidiEvent::ticksNow());
+
+                    if (held[lane].holdsChannel)
+                        pendingBulkPerChannel[held[lane].event.getStatus() & 0x0f].fetch_sub(1, std::memory_order_acq_rel);
+                }
+            }
+
+            if (numWaiting.load(std::memory_order_acquire) > 0)
+                spaceAvailable.signal();
+
+            // Sleep until enough tokens accumulate, or until something new arrives
+            if (waitMs < 0)
+                waitMs = bytesNeeded > 0 ? juce::jmax(1, (int)std::ceil(bytesNeeded * 1000.0 / rate)) : IDLE_WAIT_MS;
+
+            if (msUntilDue > 0)
+                waitMs = juce::jmin(waitMs, juce::jmax(1, (int)std::ceil(msUntilDue)));
+
+            wakeUp.wait(waitMs);
+        }
+    }
+
+    bool pushBulk(const Item& item)
+    {
+        const int channel = item.event.getStatus() & 0x0f;
+
+        if (item.holdsChannel)
+            pendingBulkPerChannel[channel].fetch_add(1, std::memory_order_acq_rel);
+
+        const bool ok = lanes[bulkLane].push(item);
+
+        if (!ok && item.holdsChannel)
+            pendingBulkPerChannel[channel].fetch_sub(1, std::memory_order_acq_rel);
+
+        return ok;
+    }
+
+    // Overwrite the value still queued for this slot, if nothing has been queued on its channel
+    // since; otherwise queue the item with a cell of its own that later values may overwrite.
+    // Pushed under the lock, so no newer value can land in a cell whose item did not make it
+    // into the lane.
+    bool pushLatestValue(Item item, int slot)
+    {
+        const int channel = item.event.getStatus() & 0x0f;
+        const uint32_t barriers = barriersPerChannel[channel].load(std::memory_order_acquire)
+            + systemBarriers.load(std::memory_order_acquire);
+
+        const juce::SpinLock::ScopedLockType sl(valueLock);
+
+        if (claimedCells[slot] >= 0 && claimedBarriers[slot] == barriers)
+        {
+            auto& cell = valueCells[claimedCells[slot]];
+            cell.event = item.event;
+            cell.fullValue = item.fullValue;
+            coalescedCount.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        // One cell per item the lane can hold, so none are left only when the lane is full
+        if (numFreeCells == 0)
+            return pushBulk(item);
+
+        item.valueCell = freeCells[numFreeCells - 1];
+
+        if (!pushBulk(item))
+            return false;
+
+        --numFreeCells;
+        valueCells[item.valueCell] = { item.event, item.fullValue, slot };
+        claimedCells[slot] = item.valueCell;
+        claimedBarriers[slot] = barriers;
+        return true;
+    }
+
+    // Scheduler thread, just before sending an item that has a value cell
+    void takeLatestValue(Item& item)
+    {
+        const juce::SpinLock::ScopedLockType sl(valueLock);
+        const auto& cell = valueCells[item.valueCell];
+
+        item.event = cell.event;
+        item.fullValue = cell.fullValue;
+
+        if (claimedCells[cell.slot] == item.valueCell)
+            claimedCells[cell.slot] = -1;
+
+        freeCells[numFreeCells++] = item.valueCell;
+        item.valueCell = -1;
+    }
+
+    template <typename Fn>
+    void waitFor(Fn&& tryEnqueue)
+    {
+        while (!tryEnqueue())
+        {
+            // Stopped: nothing will drain the lanes again
+            if (!isThreadRunning())
+                return;
+
+            numWaiting.fetch_add(1, std::memory_order_acq_rel);
+            wakeUp.signal();
+            spaceAvailable.wait(1);
+            numWaiting.fetch_sub(1, std::memory_order_acq_rel);
+        }
+    }
+
+    void recordDelay(int lane, double delayMs)
+    {
+        auto& s = stats[lane];
+        const auto us = static_cast<int64_t>(delayMs * 1000.0);
+        s.count.fetch_add(1, std::memory_order_relaxed);
+        s.totalDelayUs.fetch_add(us, std::memory_order_relaxed);
+
+        auto prev = s.maxDelayUs.load(std::memory_order_relaxed);
+        while (us > prev && !s.maxDelayUs.compare_exchange_weak(prev, us, std::memory_order_relaxed)) {}
+    }
+
+    // Jitter = how far the spacing between two sent ticks differs from their spacing on input
+    void recordClockTick(uint32_t inputTick, uint32_t sentTick)
+    {
+        // Tick differences are wrap-safe as long as clocks are less than ~35 minutes apart
+        const auto inputInterval = static_cast<int32_t>(inputTick - lastClockInputTick);
+
+        if (hasClockTick && inputInterval > 0)
+        {
+            const auto sentInterval = static_cast<int32_t>(sentTick - lastClockSentTick);
+            const auto us = static_cast<int64_t>(std::abs((int64_t)sentInterval - (int64_t)inputInterval));
+
+            clockTicks.fetch_add(1, std::memory_order_relaxed);
+            totalClockJitterUs.fetch_add(us, std::memory_order_relaxed);
+
+            auto prev = maxClockJitterUs.load(std::memory_order_relaxed);
+            while (us > prev && !maxClockJitterUs.compare_exchange_weak(prev, us, std::memory_order_relaxed)) {}
+        }
+
+        hasClockTick = true;
+        lastClockInputTick = inputTick;
+        lastClockSentTick = sentTick;
+    }
+
+    // One bit per (channel, note) for note-offs waiting in the bulk or release lane, or carried
+    // for a stolen voice. Returns whether one was already waiting.
+    bool markPendingNoteOff(int channel, int note)
+    {
+        const uint64_t bit = 1ULL << (note & 63);
+        return (pendingNoteOffs[channel][note >> 6].fetch_or(bit, std::memory_order_acq_rel) & bit) != 0;
+    }
+
+    bool clearPendingNoteOff(int channel, int note)
+    {
+        const uint64_t bit = 1ULL << (note & 63);
+        return (pendingNoteOffs[channel][note >> 6].fetch_and(~bit, std::memory_order_acq_rel) & bit) != 0;
+    }
+
+    bool isStaleNoteOff(const PackedMidiEvent& e)
+    {
+        return e.isNoteOff() && !clearPendingNoteOff(e.getStatus() & 0x0f, e.getData1());
+    }
+
+    // Queued before the last discardQueuedNotes(): note-ons and delayed releases. The order is
+    // 64-bit so it never wraps, however long the scheduler runs without a panic.
+    bool isDiscarded(int lane, const Item& item) const
+    {
+        if (item.order >= discardBefore.load(std::memory_order_relaxed))
+            return false;
+
+        return lane == releaseLane || item.event.isNoteOn();
+    }
+
+    //==============================================================================
+    static constexpr size_t LANE_SIZE = 1024;
+    static constexpr int NUM_VALUE_CELLS = static_cast<int>(LANE_SIZE) + 1; // The lane and the held item
+    static constexpr int IDLE_WAIT_MS = 100;
+
+    Sink& sink;
+    juce::WaitableEvent wakeUp;
+    juce::WaitableEvent spaceAvailable;
+    std::atomic<int> numWaiting{ 0 }; // Producers held back by a full lane
+    std::atomic<double> bytesPerSecond{ 0 };
+    std::atomic<int> bucketBytes{ 0 };
+    std::atomic<bool> byteStream{ false };
+    std::atomic<double> sysExBytesPerSecond{ 0 };
+    SysExStreamer sysex;
+    LockFreeMpscQueue<Item, LANE_SIZE> lanes[numLanes];
+    std::atomic<uint64_t> pendingNoteOffs[16][2] = {};
+    std::atomic<int> pendingBulkPerChannel[16] = {};
+    std::atomic<uint32_t> barriersPerChannel[16] = {}; // Bulk items no queued value may move across
+    std::atomic<uint32_t> systemBarriers{ 0 };         // The same for channel-less items
+    juce::SpinLock valueLock; // Guards the value cells and their claims
+    ValueCell valueCells[NUM_VALUE_CELLS];
+    int freeCells[NUM_VALUE_CELLS] = {};
+    int numFreeCells = 0;
+    int claimedCells[MidiCoalescer::NUM_KEYS];             // Cell later values for each slot overwrite, or -1
+    uint32_t claimedBarriers[MidiCoalescer::NUM_KEYS] = {}; // Barrier count when it was claimed
+    std::atomic<int64_t> coalescedCount{ 0 };
+    std::atomic<uint64_t> nextOrder{ 0 };
+    std::atomic<uint64_t> discardBefore{ 0 };
+    juce::SpinLock sendLock; // Taken by discardQueuedNotes() and around each send
+    Stats stats[numLanes];
+
+    // Clock jitter, written by the scheduler thread only
+    bool hasClockTick = false;
+    uint32_t lastClockInputTick = 0;
+    uint32_t lastClockSentTick = 0;
+    std::atomic<int64_t> clockTicks{ 0 };
+    std::atomic<int64_t> totalClockJitterUs{ 0 };
+    std::atomic<int64_t> maxClockJitterUs{ 0 };
+};
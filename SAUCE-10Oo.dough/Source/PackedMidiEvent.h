@@ -0,0 +1,102 @@
+#pragma once
+
+// A short MIDI message in eight bytes: status and both data bytes packed into one word, plus a
+// 32-bit microsecond tick. This is what the engine, its queues and the log journal pass around;
+// it only becomes a juce::MidiMessage again at the device. Predicates read the packed status byte
+// directly instead of re-decoding a message each time. SysEx never takes this form.
+struct PackedMidiEvent
+{
+    uint32_t bytes = 0; // status | data1 << 8 | data2 << 16
+    uint32_t tick = 0;  // Microseconds on Time::getMillisecondCounterHiRes(), wraps every ~71 minutes
+
+    //==============================================================================
+    static constexpr PackedMidiEvent make(int status, int data1, int data2, uint32_t tick)
+    {
+        return { static_cast<uint32_t>(status & 0xff) | static_cast<uint32_t>(data1 & 0x7f) << 8
+            | static_cast<uint32_t>(data2 & 0x7f) << 16, tick };
+    }
+
+    static PackedMidiEvent noteOn(int channel, int note, int velocity, uint32_t tick)
+    {
+        return make(0x90 | ((channel - 1) & 0x0f), note, velocity, tick);
+    }
+
+    static PackedMidiEvent noteOff(int channel, int note, uint32_t tick)
+    {
+        return make(0x80 | ((channel - 1) & 0x0f), note, 0, tick);
+    }
+
+    static PackedMidiEvent controller(int channel, int controller, int value, uint32_t tick)
+    {
+        return make(0xb0 | ((channel - 1) & 0x0f), controller, value, tick);
+    }
+
+    // Anything a MIDI input delivers except SysEx
+    static bool canPack(const juce::MidiMessage& m)
+    {
+        const int size = m.getRawDataSize();
+        const uint8_t status = size > 0 ? m.getRawData()[0] : 0;
+        return size <= 3 && status >= 0x80 && status != 0xf0 && status != 0xf7;
+    }
+
+    static PackedMidiEvent fromMidiMessage(const juce::MidiMessage& m)
+    {
+        const auto* data = m.getRawData();
+        const int size = m.getRawDataSize();
+        return make(data[0], size > 1 ? data[1] : 0, size > 2 ? data[2] : 0, secondsToTicks(m.getTimeStamp()));
+    }
+
+    juce::MidiMessage toMidiMessage() const
+    {
+        const uint8_t raw[3] = { getStatus(), static_cast<uint8_t>(getData1()), static_cast<uint8_t>(getData2()) };
+        return juce::MidiMessage(raw, getSize(), ticksToSeconds(tick));
+    }
+
+    //==============================================================================
+    static uint32_t secondsToTicks(double seconds)
+    {
+        return static_cast<uint32_t>(static_cast<uint64_t>(seconds * 1.0e6));
+    }
+
+    static uint32_t ticksNow() { return secondsToTicks(juce::Time::getMillisecondCounterHiRes() * 0.001); }
+
+    // Back to a full timestamp in seconds, for ticks within half a wrap of now
+    static double ticksToSeconds(uint32_t tick)
+    {
+        const double nowSeconds = juce::Time::getMillisecondCounterHiRes() * 0.001;
+        const auto ticksAgo = static_cast<int32_t>(secondsToTicks(nowSeconds) - tick);
+        return nowSeconds - ticksAgo * 1.0e-6;
+    }
+
+    //==============================================================================
+    uint8_t getStatus() const { return static_cast<uint8_t>(bytes); }
+    int getType() const { return bytes & 0xf0; }
+    int getChannel() const { return getStatus() < 0xf0 ? (int)(bytes & 0x0f) + 1 : 0; } // 0 = not a channel message
+    int getData1() const { return (bytes >> 8) & 0x7f; }
+    int getData2() const { return (bytes >> 16) & 0x7f; }
+
+    int getSize() const
+    {
+        const uint8_t status = getStatus();
+
+        if (status < 0xf0)
+            return (getType() == 0xc0 || getType() == 0xd0) ? 2 : 3;
+
+        switch (status)
+        {
+            case 0xf1: case 0xf3: return 2;
+            case 0xf2: return 3;
+            default:   return 1;
+        }
+    }
+
+    bool isNoteOn() const { return getType() == 0x90 && getData2() != 0; }
+    bool isNoteOff() const { return getType() == 0x80 || (getType() == 0x90 && getData2() == 0); }
+    bool isNoteOnOrOff() const { return getType() == 0x80 || getType() == 0x90; }
+    bool isController() const { return getType() == 0xb0; }
+    bool isController(int number) const { return isController() && getData1() == number; }
+    bool isSostenutoPedalOn() const { return isController(66) && getData2() >= 64; }
+    bool isSostenutoPedalOff() const { return isController(66) && getData2() < 64; }
+    bool isSostenutoPedal() const { return isController(66); }
+    bool isSystemRealTime() const { return getStatus() >= 0xf8; }
+};
@@ -91,10 +91,9 @@ public:
         }
     }
 
-    // Call this when receiving CC66 messages to update the button state
-    void handleCC66(int value)
+    // Follows the engine's sostenuto state; the threshold lives in the pedal mapping
+    void setPedalDown(bool shouldBeOn)
     {
-        bool shouldBeOn = value >= 64;
         if (getToggleState() != shouldBeOn)
         {
             setToggleState(shouldBeOn, juce::dontSendNotification);
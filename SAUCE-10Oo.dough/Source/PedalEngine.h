@@ -0,0 +1,250 @@
+#pragma once
+
+// Bit-parallel piano pedal emulation: sostenuto (CC66), sustain (CC64) and soft (CC67).
+// Every state is a 128-bit note bitmap per channel - a fixed 16 x 128 voice table - and pedals
+// combine by union of their hold masks:
+//
+//   hold      = sostenutoCaptured | (sustain down ? all notes : none)
+//   note-off  -> deferred (pending) when its bit is in hold
+//   pedal up  -> release = pending & ~pressed & ~hold, for whatever hold is left
+//
+// so sustain and sostenuto together, or one released before the other, need no per-note
+// branching. The caller owns sending the note-offs for the bits handed back.
+//
+// A pedal acts on its own channel. In MPE mode (lower zone: master channel 1, member channels
+// 2-16) a pedal on the master channel acts on the whole zone, so sostenuto captures every
+// sounding voice whichever member channel it was allocated to, and releases each on its own.
+class PedalEngine
+{
+public:
+    enum Pedal
+    {
+        sustain = 0,
+        sostenuto,
+        soft,
+        numPedals
+    };
+
+    static constexpr int NUM_CHANNELS = 16;
+    static constexpr int MPE_MASTER_CHANNEL = 1;
+    static constexpr uint16_t ALL_CHANNELS = 0xffff;
+
+    using NoteBits = uint64_t[2];
+
+    // Notes a pedal change lets go of, per channel (channel 1 at index 0)
+    struct Voices
+    {
+        NoteBits notes[NUM_CHANNELS];
+        uint16_t channels = 0; // Channels with at least one note set
+    };
+
+    // Soft pedal: note-on velocities are scaled by this while it is down
+    static constexpr int SOFT_VELOCITY_PERCENT = 70;
+
+    //==============================================================================
+    void setMpeMode(bool shouldUseMpe) { mpeMode.store(shouldUseMpe, std::memory_order_relaxed); }
+    bool isMpeMode() const { return mpeMode.load(std::memory_order_relaxed); }
+
+    // The channels a pedal message on this channel acts on
+    uint16_t getScope(int channel) const
+    {
+        if (!isValidChannel(channel))
+            return ALL_CHANNELS;
+
+        return isMpeMode() && channel == MPE_MASTER_CHANNEL ? ALL_CHANNELS : channelBit(channel);
+    }
+
+    //==============================================================================
+    void noteOn(int channel, int note)
+    {
+        if (!isValidChannel(channel) || !isValidNote(note))
+            return;
+
+        const int c = channel - 1;
+        const auto bit = noteBit(note);
+        pressed[c][note >> 6] |= bit;
+        pending[c][note >> 6] &= ~bit; // Struck again - a later release decides afresh
+        active |= channelBit(channel);
+    }
+
+    // Returns true if the note-off should be sent now, false if a pedal keeps the note sounding
+    bool noteOff(int channel, int note)
+    {
+        if (!isValidChannel(channel) || !isValidNote(note))
+            return true;
+
+        const int c = channel - 1;
+        const auto bit = noteBit(note);
+        pressed[c][note >> 6] &= ~bit;
+
+        if ((getHoldMask(c, note >> 6) & bit) == 0)
+        {
+            updateActive(c);
+            return true;
+        }
+
+        pending[c][note >> 6] |= bit;
+        return false;
+    }
+
+    // maxVelocity is 127 for MIDI 1.0 and 65535 for a MIDI 2.0 note
+    int scaleVelocity(int channel, int velocity, int maxVelocity = 127) const
+    {
+        if (!isPedalDown(soft, channel) || velocity == 0)
+            return velocity;
+
+        return juce::jlimit(1, maxVelocity, (velocity * SOFT_VELOCITY_PERCENT + 50) / 100);
+    }
+
+    // Apply a pedal change to the channels in scope. Notes that should stop sounding now are
+    // written to release. Returns the channels whose pedal actually changed (0 = none).
+    uint16_t setPedal(Pedal pedal, bool isDown, uint16_t scope, Voices& release)
+    {
+        release.channels = 0;
+
+        const auto changed = static_cast<uint16_t>(scope & (isDown ? ~down[pedal] : down[pedal]));
+        if (changed == 0)
+            return 0;
+
+        down[pedal] = static_cast<uint16_t>(isDown ? (down[pedal] | changed) : (down[pedal] & ~changed));
+
+        for (uint16_t channels = changed; channels != 0; channels &= channels - 1)
+        {
+            const int c = lowestChannel(channels);
+
+            // Sostenuto catches every damper that is up right now: keys held down, and notes
+            // already kept sounding by the sustain pedal
+            if (pedal == sostenuto)
+            {
+                for (size_t k = 0; k < 2; ++k)
+                    captured[c][k] = isDown ? (pressed[c][k] | pending[c][k]) : 0;
+            }
+
+            if (!isDown)
+            {
+                auto& notes = release.notes[c];
+
+                for (size_t k = 0; k < 2; ++k)
+                {
+                    notes[k] = pending[c][k] & ~pressed[c][k] & ~getHoldMask(c, k);
+                    pending[c][k] &= ~notes[k];
+                }
+
+                if ((notes[0] | notes[1]) != 0)
+                    release.channels |= static_cast<uint16_t>(1u << c);
+
+                updateActive(c);
+            }
+        }
+
+        return changed;
+    }
+
+    bool isPedalDown(Pedal pedal, int channel) const
+    {
+        return isValidChannel(channel) && (down[pedal] & channelBit(channel)) != 0;
+    }
+
+    // Keys physically down on one channel
+    uint64_t getPressedBits(int channel, size_t word) const
+    {
+        return isValidChannel(channel) ? pressed[channel - 1][word] : 0;
+    }
+
+    // Notes a pedal is holding or will hold on release, on any channel - what the keyboard view shows
+    uint64_t getHeldBits(size_t word) const
+    {
+        uint64_t bits = 0;
+
+        for (uint16_t channels = active; channels != 0; channels &= channels - 1)
+        {
+            const int c = lowestChannel(channels);
+            bits |= captured[c][word] | pending[c][word];
+        }
+
+        return bits;
+    }
+
+    // Key released, note kept sounding only by a pedal
+    bool isSustainedByPedal(int channel, int note) const
+    {
+        return isValidChannel(channel) && isValidNote(note) && (pending[channel - 1][note >> 6] & noteBit(note)) != 0;
+    }
+
+    // Sounding because of a pedal: released under sustain or sostenuto, or caught by sostenuto
+    bool isHeldByPedal(int channel, int note) const
+    {
+        if (!isValidChannel(channel) || !isValidNote(note))
+            return false;
+
+        const int c = channel - 1;
+        return ((pending[c][note >> 6] | captured[c][note >> 6]) & noteBit(note)) != 0;
+    }
+
+    // The note was ended elsewhere (voice stealing, a stuck note released): no key or pedal
+    // holds or releases it any more
+    void forget(int channel, int note)
+    {
+        if (!isValidChannel(channel) || !isValidNote(note))
+            return;
+
+        const int c = channel - 1;
+        pressed[c][note >> 6] &= ~noteBit(note);
+        pending[c][note >> 6] &= ~noteBit(note);
+        captured[c][note >> 6] &= ~noteBit(note);
+        updateActive(c);
+    }
+
+    void reset()
+    {
+        for (int c = 0; c < NUM_CHANNELS; ++c)
+            for (size_t k = 0; k < 2; ++k)
+                pressed[c][k] = pending[c][k] = captured[c][k] = 0;
+
+        for (auto& d : down)
+            d = 0;
+
+        active = 0;
+    }
+
+private:
+    uint64_t getHoldMask(int c, size_t word) const
+    {
+        return captured[c][word] | ((down[sustain] >> c) & 1 ? ~0ULL : 0ULL);
+    }
+
+    // Drop a channel from the active set once nothing on it is pressed or held
+    void updateActive(int c)
+    {
+        if ((pressed[c][0] | pressed[c][1] | pending[c][0] | pending[c][1] | captured[c][0] | captured[c][1]) == 0)
+            active &= static_cast<uint16_t>(~(1u << c));
+    }
+
+    static int lowestChannel(uint16_t channels)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward(&index, channels);
+        return static_cast<int>(index);
+#elif defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctz(channels);
+#else
+        int index = 0;
+        while ((channels & 1) == 0) { channels >>= 1; ++index; }
+        return index;
+#endif
+    }
+
+    static constexpr bool isValidNote(int note) { return note >= 0 && note < 128; }
+    static constexpr bool isValidChannel(int channel) { return channel >= 1 && channel <= NUM_CHANNELS; }
+    static constexpr uint64_t noteBit(int note) { return 1ULL << (note & 63); }
+    static constexpr uint16_t channelBit(int channel) { return static_cast<uint16_t>(1u << (channel - 1)); }
+
+    //==============================================================================
+    uint64_t pressed[NUM_CHANNELS][2] = {};  // Keys physically down
+    uint64_t pending[NUM_CHANNELS][2] = {};  // Note-offs held back by a pedal
+    uint64_t captured[NUM_CHANNELS][2] = {}; // Caught by the sostenuto pedal
+    uint16_t down[numPedals] = {};           // Per pedal, the channels it is down on
+    uint16_t active = 0;                     // Channels with anything pressed or held
+    std::atomic<bool> mpeMode{ false };
+};
@@ -0,0 +1,228 @@
+#pragma once
+#include "PedalEngine.h"
+#include "PackedMidiEvent.h"
+
+// Turns incoming controllers, notes or program changes into pedal presses.
+// Each pedal has one source - a CC (with a hysteresis band), a note (on = down) or a program
+// change (each one toggles) - optionally inverted. Sources are compiled into one 128-entry
+// table per message kind, so classifying an event is a single indexed load, and a CC value
+// only changes a pedal once it leaves the band, so a noisy half-pedal hovering near the
+// threshold cannot cycle capture/release.
+//
+// Tables are atomics: the input thread reads them while the GUI (or MIDI learn) rewrites them.
+class PedalMapper
+{
+public:
+    enum SourceType
+    {
+        controllerSource = 0,
+        noteSource,
+        programChangeSource,
+        numSourceTypes
+    };
+
+    enum Hysteresis
+    {
+        noHysteresis = 0, // Down at >= 64, up at <= 63
+        narrowBand,       // Down at >= 72, up at <= 56
+        wideBand,         // Down at >= 96, up at <= 32
+        numHysteresisModes
+    };
+
+    struct Source
+    {
+        SourceType type = controllerSource;
+        int number = 0;
+        bool inverted = false;
+        Hysteresis hysteresis = noHysteresis;
+    };
+
+    struct Change
+    {
+        PedalEngine::Pedal pedal = PedalEngine::sostenuto;
+        bool isDown = false;
+    };
+
+    // The MIDI-spec threshold by default; a band is only for noisy continuous pedals that ask
+    // for one
+    PedalMapper()
+    {
+        setSource(PedalEngine::sustain, { controllerSource, 64, false, noHysteresis });
+        setSource(PedalEngine::sostenuto, { controllerSource, 66, false, noHysteresis });
+        setSource(PedalEngine::soft, { controllerSource, 67, false, noHysteresis });
+    }
+
+    //==============================================================================
+    void setSource(PedalEngine::Pedal pedal, const Source& source)
+    {
+        sources[pedal].store(packSource(source), std::memory_order_relaxed);
+        rebuild();
+    }
+
+    Source getSource(PedalEngine::Pedal pedal) const
+    {
+        return unpackSource(sources[pedal].load(std::memory_order_relaxed));
+    }
+
+    // A disabled pedal's source passes through as an ordinary message
+    void setPedalEnabled(PedalEngine::Pedal pedal, bool shouldBeEnabled)
+    {
+        enabled[pedal].store(shouldBeEnabled, std::memory_order_relaxed);
+    }
+
+    // The next CC, note-on or program change becomes this pedal's source
+    void learn(PedalEngine::Pedal pedal) { learning.store(pedal, std::memory_order_relaxed); }
+    void cancelLearn() { learning.store(-1, std::memory_order_relaxed); }
+    bool isLearning() const { return learning.load(std::memory_order_relaxed) >= 0; }
+
+    // Input thread: returns true if the event was consumed as the learned source
+    bool learnFrom(const PackedMidiEvent& e)
+    {
+        const int pedal = learning.load(std::memory_order_relaxed);
+        if (pedal < 0)
+            return false;
+
+        const int kind = getSourceType(e);
+        if (kind < 0 || (kind == noteSource && !e.isNoteOn()))
+            return false;
+
+        int expected = pedal;
+        if (!learning.compare_exchange_strong(expected, -1))
+            return false;
+
+        auto source = getSource(static_cast<PedalEngine::Pedal>(pedal));
+        source.type = static_cast<SourceType>(kind);
+        source.number = e.getData1();
+        setSource(static_cast<PedalEngine::Pedal>(pedal), source);
+        return true;
+    }
+
+    //==============================================================================
+    bool isMapped(const PackedMidiEvent& e) const
+    {
+        return lookupEntry(e) != 0;
+    }
+
+    // If e drives a pedal, return true and describe the resulting state in change.
+    // The engine's current state decides inside the hysteresis band and for toggles.
+    bool map(const PackedMidiEvent& e, const PedalEngine& engine, Change& change) const
+    {
+        const uint32_t entry = lookupEntry(e);
+        if (entry == 0)
+            return false;
+
+        change.pedal = static_cast<PedalEngine::Pedal>((entry & PEDAL_MASK) - 1);
+        const bool current = engine.isPedalDown(change.pedal, e.getChannel());
+        const bool inverted = (entry & INVERTED_BIT) != 0;
+
+        switch (getSourceType(e))
+        {
+            case controllerSource:
+            {
+                const int value = inverted ? 127 - e.getData2() : e.getData2();
+                const int downAt = (entry >> DOWN_SHIFT) & 0x7f;
+                const int upAt = (entry >> UP_SHIFT) & 0x7f;
+                change.isDown = value >= downAt ? true : (value <= upAt ? false : current);
+                break;
+            }
+
+            case noteSource:
+                change.isDown = e.isNoteOn() != inverted;
+                break;
+
+            default:
+                change.isDown = !current; // Program change toggles
+                break;
+        }
+
+        return true;
+    }
+
+    juce::String describe(PedalEngine::Pedal pedal) const
+    {
+        const auto source = getSource(pedal);
+        juce::String text;
+
+        switch (source.type)
+        {
+            case controllerSource:    text << "CC" << source.number; break;
+            case noteSource:          text << juce::MidiMessage::getMidiNoteName(source.number, true, true, 3); break;
+            default:                  text << "PC" << source.number; break;
+        }
+
+        return source.inverted ? text + " (inv)" : text;
+    }
+
+private:
+    // Table entry: pedal + 1 (0 = unmapped) | inverted | down threshold | up threshold
+    static constexpr uint32_t PEDAL_MASK = 0x3;
+    static constexpr uint32_t INVERTED_BIT = 0x4;
+    static constexpr int DOWN_SHIFT = 3;
+    static constexpr int UP_SHIFT = 10;
+
+    static constexpr int bandThresholds[numHysteresisModes][2] = { { 64, 63 }, { 72, 56 }, { 96, 32 } };
+
+    // -1 for messages that can never be a pedal source
+    static int getSourceType(const PackedMidiEvent& e)
+    {
+        switch (e.getType())
+        {
+            case 0xb0: return controllerSource;
+            case 0x80:
+            case 0x90: return noteSource;
+            case 0xc0: return programChangeSource;
+            default:   return -1;
+        }
+    }
+
+    uint32_t lookupEntry(const PackedMidiEvent& e) const
+    {
+        const int kind = getSourceType(e);
+        if (kind < 0 || e.getStatus() >= 0xf0)
+            return 0;
+
+        const uint32_t entry = tables[kind][e.getData1()].load(std::memory_order_relaxed);
+        const uint32_t pedal = entry & PEDAL_MASK;
+        return pedal != 0 && enabled[pedal - 1].load(std::memory_order_relaxed) ? entry : 0;
+    }
+
+    void rebuild()
+    {
+        const juce::SpinLock::ScopedLockType sl(rebuildLock);
+        uint32_t next[numSourceTypes][128] = {};
+
+        for (int pedal = 0; pedal < PedalEngine::numPedals; ++pedal)
+        {
+            const auto source = getSource(static_cast<PedalEngine::Pedal>(pedal));
+            const auto* band = bandThresholds[source.hysteresis];
+            const uint32_t entry = static_cast<uint32_t>(pedal + 1) | (source.inverted ? INVERTED_BIT : 0)
+                | static_cast<uint32_t>(band[0]) << DOWN_SHIFT | static_cast<uint32_t>(band[1]) << UP_SHIFT;
+
+            next[source.type][source.number & 0x7f] = entry;
+        }
+
+        // Entry by entry, so a lookup racing the rebuild sees either the old or the new mapping
+        for (int kind = 0; kind < numSourceTypes; ++kind)
+            for (int number = 0; number < 128; ++number)
+                tables[kind][number].store(next[kind][number], std::memory_order_relaxed);
+    }
+
+    static uint32_t packSource(const Source& s)
+    {
+        return static_cast<uint32_t>(s.type) | static_cast<uint32_t>(s.number & 0x7f) << 2
+            | (s.inverted ? 1u << 9 : 0u) | static_cast<uint32_t>(s.hysteresis) << 10;
+    }
+
+    static Source unpackSource(uint32_t packed)
+    {
+        return { static_cast<SourceType>(packed & 0x3), static_cast<int>((packed >> 2) & 0x7f),
+            (packed & (1u << 9)) != 0, static_cast<Hysteresis>((packed >> 10) & 0x3) };
+    }
+
+    //==============================================================================
+    std::atomic<uint32_t> tables[numSourceTypes][128] = {};
+    std::atomic<uint32_t> sources[PedalEngine::numPedals] = {};
+    std::atomic<bool> enabled[PedalEngine::numPedals] = { {true}, {true}, {true} };
+    std::atomic<int> learning{ -1 };
+    juce::SpinLock rebuildLock;
+};
@@ -0,0 +1,273 @@
+#pragma once
+#include "EngineEventStream.h"
+
+// Scrolling view of input notes, output notes and pedal spans over the last few seconds.
+// Drawn into a ring image: each frame only the newly elapsed columns are painted, and paint()
+// blits the two halves of the ring so the image never has to be redrawn or moved.
+class PianoRollComponent : public juce::Component
+{
+public:
+    enum ColourIds
+    {
+        backgroundColourId = 0x1fff101,
+        inputNoteColourId = 0x1fff102,
+        outputNoteColourId = 0x1fff103,
+        pedalSpanColourId = 0x1fff104
+    };
+
+    PianoRollComponent(EngineEventStream& stream)
+        : eventStream(stream),
+        frameTimer(this)
+    {
+        setOpaque(true);
+        setColour(backgroundColourId, juce::Colour(0xff101010));
+        setColour(inputNoteColourId, juce::Colours::white.withAlpha(0.9f));
+        setColour(outputNoteColourId, juce::Colour(0xffd4a017));
+        setColour(pedalSpanColourId, juce::Colours::darkred.withAlpha(0.35f));
+    }
+
+    ~PianoRollComponent() override
+    {
+        frameTimer.stopTimer();
+    }
+
+    // How much history fits across the width of the panel
+    void setVisibleSeconds(double seconds)
+    {
+        visibleSeconds = juce::jmax(0.5, seconds);
+        clearRing();
+    }
+
+    void setNoteRange(int lowest, int highest)
+    {
+        lowestNote = juce::jlimit(0, 127, juce::jmin(lowest, highest));
+        highestNote = juce::jlimit(0, 127, juce::jmax(lowest, highest));
+        clearRing();
+    }
+
+    void paint(juce::Graphics& g) override
+    {
+        if (!ring.isValid())
+        {
+            g.fillAll(findColour(backgroundColourId));
+            return;
+        }
+
+        // Oldest columns are to the right of the write head, newest to the left of it
+        const int w = ring.getWidth();
+        const int h = ring.getHeight();
+        const int older = w - writeX;
+
+        g.drawImage(ring, 0, 0, older, h, writeX, 0, older, h);
+        if (writeX > 0)
+            g.drawImage(ring, older, 0, writeX, h, 0, 0, writeX, h);
+    }
+
+    void resized() override
+    {
+        clearRing();
+    }
+
+    void visibilityChanged() override
+    {
+        if (isVisible())
+        {
+            // Throw away anything published while hidden
+            EngineEvent e;
+            while (eventStream.read(e)) {}
+
+            lastFrameTime = juce::Time::getMillisecondCounterHiRes() * 0.001;
+            pixelRemainder = 0.0;
+            frameTimer.startTimerHz(FRAME_RATE);
+        }
+        else
+        {
+            frameTimer.stopTimer();
+        }
+    }
+
+    // Drain the stream and append the columns that elapsed since the last frame
+    void advanceFrame()
+    {
+        // Notes that started during this frame are drawn even if they already ended
+        uint64_t inputTouched[2] = { inputBits[0], inputBits[1] };
+        uint64_t outputTouched[2] = { outputBits[0], outputBits[1] };
+        bool pedalTouched = pedalDown;
+
+        EngineEvent e;
+        while (eventStream.read(e))
+        {
+            const size_t k = e.note >> 6;
+            const uint64_t bit = 1ULL << (e.note & 63);
+
+            switch (e.type)
+            {
+                case EngineEvent::inputNoteOn:   inputBits[k] |= bit;  inputTouched[k] |= bit;  break;
+                case EngineEvent::inputNoteOff:  inputBits[k] &= ~bit; break;
+                case EngineEvent::outputNoteOn:  outputBits[k] |= bit; outputTouched[k] |= bit; break;
+                case EngineEvent::outputNoteOff: outputBits[k] &= ~bit; break;
+                case EngineEvent::pedalDown:     pedalDown = true; pedalTouched = true; break;
+                case EngineEvent::pedalUp:       pedalDown = false; break;
+                default: break;
+            }
+        }
+
+        pendingInput[0] |= inputTouched[0];
+        pendingInput[1] |= inputTouched[1];
+        pendingOutput[0] |= outputTouched[0];
+        pendingOutput[1] |= outputTouched[1];
+        pendingPedal = pendingPedal || pedalTouched;
+
+        if (!ring.isValid())
+            return;
+
+        const double now = juce::Time::getMillisecondCounterHiRes() * 0.001;
+        const double pixelsPerSecond = ring.getWidth() / visibleSeconds;
+        pixelRemainder += (now - lastFrameTime) * pixelsPerSecond;
+        lastFrameTime = now;
+
+        const int columns = juce::jmin(static_cast<int>(pixelRemainder), ring.getWidth());
+        if (columns <= 0)
+            return;
+
+        pixelRemainder -= columns;
+        appendColumns(columns);
+
+        pendingInput[0] = pendingInput[1] = 0;
+        pendingOutput[0] = pendingOutput[1] = 0;
+        pendingPedal = false;
+
+        repaint();
+    }
+
+private:
+    // Timer class to drive the scroll at a fixed frame rate
+    class FrameTimer : public juce::Timer
+    {
+    public:
+        FrameTimer(PianoRollComponent* owner) : owner(owner) {}
+        void timerCallback() override { owner->advanceFrame(); }
+    private:
+        PianoRollComponent* owner;
+    };
+
+    void clearRing()
+    {
+        if (getWidth() <= 0 || getHeight() <= 0)
+        {
+            ring = {};
+            return;
+        }
+
+        ring = juce::Image(juce::Image::RGB, getWidth(), getHeight(), false);
+        juce::Graphics g(ring);
+        g.fillAll(findColour(backgroundColourId));
+        writeX = 0;
+        pixelRemainder = 0.0;
+        repaint();
+    }
+
+    // Paint [writeX, writeX + columns) handling wrap-around, then move the write head
+    void appendColumns(int columns)
+    {
+        juce::Graphics g(ring);
+        const int w = ring.getWidth();
+
+        while (columns > 0)
+        {
+            const int span = juce::jmin(columns, w - writeX);
+            drawColumns(g, writeX, span);
+            writeX = (writeX + span) % w;
+            columns -= span;
+        }
+    }
+
+    // Cost is proportional to the number of sounding notes, not the panel size
+    void drawColumns(juce::Graphics& g, int x, int width)
+    {
+        const float h = static_cast<float>(ring.getHeight());
+        const float rowHeight = h / static_cast<float>(highestNote - lowestNote + 1);
+        const juce::Rectangle<float> column(static_cast<float>(x), 0.0f, static_cast<float>(width), h);
+
+        g.setColour(findColour(backgroundColourId));
+        g.fillRect(column);
+
+        if (pendingPedal)
+        {
+            g.setColour(findColour(pedalSpanColourId));
+            g.fillRect(column);
+        }
+
+        // Output notes fill their whole row, input notes a thinner bar on top -
+        // where the two differ is exactly where the pedal extended a note
+        g.setColour(findColour(outputNoteColourId));
+        drawNoteRows(g, pendingOutput, column, rowHeight, 0.0f);
+
+        g.setColour(findColour(inputNoteColourId));
+        drawNoteRows(g, pendingInput, column, rowHeight, rowHeight * 0.3f);
+    }
+
+    void drawNoteRows(juce::Graphics& g, const uint64_t* bits, juce::Rectangle<float> column, float rowHeight, float inset)
+    {
+        for (size_t k = 0; k < 2; ++k)
+        {
+            uint64_t bitset = bits[k];
+
+            while (bitset != 0)
+            {
+                const int note = static_cast<int>(k) * 64 + countTrailingZeros(bitset);
+                bitset &= bitset - 1; // Clear lowest set bit
+
+                if (note < lowestNote || note > highestNote)
+                    continue;
+
+                const float y = (highestNote - note) * rowHeight;
+                g.fillRect(column.getX(), y + inset, column.getWidth(), juce::jmax(1.0f, rowHeight - inset * 2.0f));
+            }
+        }
+    }
+
+    // Platform-independent trailing zero count
+    static inline int countTrailingZeros(uint64_t x)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, x);
+        return static_cast<int>(index);
+#elif defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctzll(x);
+#else
+        int count = 0;
+        while ((x & 1) == 0) {
+            x >>= 1;
+            count++;
+        }
+        return count;
+#endif
+    }
+
+    //==============================================================================
+    static constexpr int FRAME_RATE = 60; // Hz
+
+    EngineEventStream& eventStream;
+    FrameTimer frameTimer;
+    juce::Image ring;
+    int writeX = 0;
+    double visibleSeconds = 8.0;
+    double lastFrameTime = 0;
+    double pixelRemainder = 0;
+    int lowestNote = 21;  // A0
+    int highestNote = 108; // C8
+
+    // Current note state as seen on the stream
+    uint64_t inputBits[2] = { 0, 0 };
+    uint64_t outputBits[2] = { 0, 0 };
+    bool pedalDown = false;
+
+    // Everything that sounded since the last appended column
+    uint64_t pendingInput[2] = { 0, 0 };
+    uint64_t pendingOutput[2] = { 0, 0 };
+    bool pendingPedal = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PianoRollComponent)
+};
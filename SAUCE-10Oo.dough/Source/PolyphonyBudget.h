@@ -0,0 +1,176 @@
+#pragma once
+#include "PedalEngine.h"
+
+// Caps how many notes the engine leaves sounding downstream. Every note-on that would go over
+// the limit first releases a victim: the note that has been held by a pedal longest, or - with
+// nothing pedal-held - the oldest sounding note.
+//
+// Sounding notes are a 16 x 128 bitmap. Candidates wait in two age-ordered rings and are checked
+// lazily when popped. A re-struck or re-held note is pushed again with a new stamp, which makes
+// its older entry stale, so its age is always that of its latest strike. A ring that fills up
+// with stale entries is compacted, so each event still costs O(1) amortised.
+class PolyphonyBudget
+{
+public:
+    struct Voice
+    {
+        int channel = 1;
+        int note = 0;
+    };
+
+    void setLimit(int voices) { limit.store(juce::jmax(0, voices), std::memory_order_relaxed); } // 0 = unlimited
+    int getLimit() const { return limit.load(std::memory_order_relaxed); }
+
+    // A note-on is about to be sent. Returns true, with the voice to release first, if it
+    // would otherwise exceed the limit.
+    bool admitNoteOn(int channel, int note, const PedalEngine& engine, Voice& victim)
+    {
+        const juce::SpinLock::ScopedLockType sl(lock);
+        const int key = toKey(channel, note);
+        bool mustSteal = false;
+
+        if (isSet(sounding, key))
+        {
+            push(struck, key); // Re-strike - no new voice, but the note is young again
+            return false;
+        }
+
+        const int max = getLimit();
+
+        if (max > 0 && numSounding >= max)
+        {
+            mustSteal = popVictim(held, engine, true, victim) || popVictim(struck, engine, false, victim);
+
+            if (mustSteal)
+            {
+                clear(sounding, toKey(victim.channel, victim.note));
+                --numSounding;
+                stolen.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        set(sounding, key);
+        ++numSounding;
+        push(struck, key);
+        return mustSteal;
+    }
+
+    void noteOff(int channel, int note)
+    {
+        const juce::SpinLock::ScopedLockType sl(lock);
+        const int key = toKey(channel, note);
+
+        if (isSet(sounding, key))
+        {
+            clear(sounding, key);
+            --numSounding;
+        }
+    }
+
+    // A pedal has just taken over this note - it becomes a candidate in the order it happened
+    void noteHeld(int channel, int note)
+    {
+        const juce::SpinLock::ScopedLockType sl(lock);
+        push(held, toKey(channel, note));
+    }
+
+    void reset()
+    {
+        const juce::SpinLock::ScopedLockType sl(lock);
+        std::memset(sounding, 0, sizeof(sounding));
+        std::memset(held.stamps, 0, sizeof(held.stamps));
+        std::memset(struck.stamps, 0, sizeof(struck.stamps));
+        held.head = held.size = struck.head = struck.size = 0;
+        numSounding = 0;
+    }
+
+    int64_t getStolenCount() const { return stolen.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr int NUM_KEYS = PedalEngine::NUM_CHANNELS * 128;
+
+    // Room for one live entry per key and as many stale ones
+    static constexpr int RING_SIZE = 2 * NUM_KEYS;
+
+    struct Entry
+    {
+        uint16_t key = 0;
+        uint32_t stamp = 0;
+    };
+
+    struct Ring
+    {
+        Entry entries[RING_SIZE];
+        uint32_t stamps[NUM_KEYS] = {}; // Stamp of each key's live entry, 0 if none
+        int head = 0;
+        int size = 0;
+    };
+
+    static int toKey(int channel, int note) { return ((channel - 1) & 0x0f) << 7 | (note & 0x7f); }
+    static bool isSet(const uint64_t* bits, int key) { return (bits[key >> 6] >> (key & 63) & 1) != 0; }
+    static void set(uint64_t* bits, int key) { bits[key >> 6] |= 1ULL << (key & 63); }
+    static void clear(uint64_t* bits, int key) { bits[key >> 6] &= ~(1ULL << (key & 63)); }
+
+    // The key's newest entry; any older one goes stale
+    void push(Ring& ring, int key)
+    {
+        if (ring.size == RING_SIZE)
+            compact(ring);
+
+        if (++nextStamp == 0)
+            ++nextStamp; // 0 marks no entry
+
+        ring.stamps[key] = nextStamp;
+        ring.entries[(ring.head + ring.size++) % RING_SIZE] = { static_cast<uint16_t>(key), nextStamp };
+    }
+
+    // Drop the stale entries, keeping the live ones in order. At most NUM_KEYS are live, so this
+    // frees at least half the ring.
+    static void compact(Ring& ring)
+    {
+        int kept = 0;
+
+        for (int i = 0; i < ring.size; ++i)
+        {
+            const auto& entry = ring.entries[(ring.head + i) % RING_SIZE];
+
+            if (ring.stamps[entry.key] == entry.stamp)
+                ring.entries[(ring.head + kept++) % RING_SIZE] = entry;
+        }
+
+        ring.size = kept;
+    }
+
+    // Oldest entry still worth stealing; stale entries are discarded on the way
+    bool popVictim(Ring& ring, const PedalEngine& engine, bool mustBePedalHeld, Voice& victim)
+    {
+        while (ring.size > 0)
+        {
+            const auto entry = ring.entries[ring.head];
+            ring.head = (ring.head + 1) % RING_SIZE;
+            --ring.size;
+
+            const int key = entry.key;
+
+            if (ring.stamps[key] != entry.stamp)
+                continue; // Pushed again since
+
+            ring.stamps[key] = 0;
+            victim = { (key >> 7) + 1, key & 0x7f };
+
+            if (isSet(sounding, key) && (!mustBePedalHeld || engine.isSustainedByPedal(victim.channel, victim.note)))
+                return true;
+        }
+
+        return false;
+    }
+
+    //==============================================================================
+    juce::SpinLock lock;
+    uint64_t sounding[NUM_KEYS / 64] = {};
+    Ring held, struck;
+    uint32_t nextStamp = 0;
+    int numSounding = 0;
+    std::atomic<int> limit{ 0 };
+    std::atomic<int64_t> stolen{ 0 };
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+// Spreads the note-offs of one pedal release over a short window, so a sampler does not start
+// fifty release tails in the same audio block. Voices are ordered by the chosen policy and
+// given evenly spaced delays from 0 up to (not including) the window; the output scheduler's
+// release lane does the waiting.
+class ReleaseSpreader
+{
+public:
+    enum Order
+    {
+        lowToHigh = 0, // By pitch
+        oldestFirst,   // By when the key was struck
+        interleaved,   // Alternating from both ends of the keyboard
+        numOrders
+    };
+
+    struct Voice
+    {
+        uint8_t channel = 1;
+        uint8_t note = 0;
+        uint32_t struckAt = 0; // Tick of the note-on
+    };
+
+    static constexpr int MAX_WINDOW_MS = 15;
+
+    static const char* getOrderName(Order order)
+    {
+        switch (order)
+        {
+            case lowToHigh:   return "Low to high";
+            case oldestFirst: return "Oldest first";
+            case interleaved: return "Interleaved";
+            default:          return "";
+        }
+    }
+
+    void setWindowMs(int ms) { windowMs.store(juce::jlimit(0, MAX_WINDOW_MS, ms), std::memory_order_relaxed); }
+    int getWindowMs() const { return windowMs.load(std::memory_order_relaxed); }
+
+    void setOrder(Order newOrder) { order.store(newOrder, std::memory_order_relaxed); }
+    Order getOrder() const { return static_cast<Order>(order.load(std::memory_order_relaxed)); }
+
+    bool isEnabled() const { return getWindowMs() > 0; }
+
+    // Sort voices into send order and call fn(voice, delayMs) for each, delays ascending
+    template <typename Fn>
+    void schedule(std::vector<Voice>& voices, uint32_t nowTick, Fn&& fn)
+    {
+        if (voices.empty())
+            return;
+
+        const auto byPitch = [](const Voice& a, const Voice& b) {
+            return a.note != b.note ? a.note < b.note : a.channel < b.channel;
+        };
+
+        switch (getOrder())
+        {
+            case oldestFirst:
+                // Tick differences from now are wrap-safe; the oldest is the most negative
+                std::sort(voices.begin(), voices.end(), [nowTick](const Voice& a, const Voice& b) {
+                    return static_cast<int32_t>(a.struckAt - nowTick) < static_cast<int32_t>(b.struckAt - nowTick);
+                });
+                break;
+
+            case interleaved:
+            {
+                std::sort(voices.begin(), voices.end(), byPitch);
+                interleaveScratch.assign(voices.begin(), voices.end());
+
+                size_t low = 0, high = voices.size() - 1;
+                for (size_t i = 0; i < voices.size(); ++i)
+                    voices[i] = (i & 1) == 0 ? interleaveScratch[low++] : interleaveScratch[high--];
+
+                break;
+            }
+
+            default:
+                std::sort(voices.begin(), voices.end(), byPitch);
+                break;
+        }
+
+        const double spacingMs = static_cast<double>(getWindowMs()) / static_cast<double>(voices.size());
+
+        for (size_t i = 0; i < voices.size(); ++i)
+            fn(voices[i], spacingMs * static_cast<double>(i));
+    }
+
+private:
+    std::atomic<int> windowMs{ 0 };
+    std::atomic<int> order{ lowToHigh };
+    std::vector<Voice> interleaveScratch;
+};
@@ -74,19 +74,66 @@ static int countNewlines(const juce::String& str)
 #pragma once
 #include <JuceHeader.h>
 #include "PedalButton.h"
+#include "SostenutoKeyboardComponent.h"
+#include "PianoRollComponent.h"
+#include "MidiWireEncoder.h"
+#include "OutputScheduler.h"
+#include "IngressSequencer.h"
+#include "MidiCoalescer.h"
+#include "PackedMidiEvent.h"
+#include "EventClassifier.h"
+#include "PedalEngine.h"
+#include "PedalMapper.h"
+#include "UniversalMidiPacket.h"
+#include "OutputLedger.h"
+#include "NoteOutputFilter.h"
+#include "ReleaseSpreader.h"
+#include "PolyphonyBudget.h"
+#include "FeedbackLoopDetector.h"
+#include "StuckNoteReaper.h"
+#include "MidiInputMerger.h"
+#include "OutputRouter.h"
 
 //==============================================================================
 class MainContentComponent : public juce::Component,
-    private juce::MidiInputCallback,
+    public Ump::Receiver,
     private juce::MidiKeyboardStateListener,
-    private juce::AsyncUpdater
+    private juce::AsyncUpdater,
+    private OutputScheduler::Sink,
+    private MidiInputMerger::Consumer
 {
 public:
-    // Simple structure to hold log entries
+    // Where a log entry came from
+    enum class LogSource : uint8_t
+    {
+        input,
+        pedalButton,
+        onScreenKeyboard,
+        heldByPedal,
+        pedalRelease,
+        voiceStolen,
+        stuckNote,
+        ump
+    };
+
+    // Journal entry - fixed size, so writing one never allocates. SysEx is recorded by size only.
     struct LogEntry {
-        juce::MidiMessage message;
-        juce::String source;
-        double timestamp;
+        PackedMidiEvent event;
+        LogSource source = LogSource::input;
+        int sysexBytes = 0;
+        uint8_t input = 0; // Which input, for LogSource::input
+    };
+
+    // Engine work the message thread hands to the merge thread, the only thread that runs the
+    // engine. Each travels through the input merger's command ring with an event for its data.
+    enum class Command : uint8_t
+    {
+        keyboardNote,          // An on-screen key, as its note-on or note-off
+        pedalButton,           // The sostenuto button, as CC66 on channel 1
+        reapStuckNotes,
+        panic,
+        releaseEmulatedPedals, // Sustain and soft emulation was switched off
+        toggleMpe
     };
 
     // Timer class to handle log updates at a consistent rate
@@ -94,97 +141,111 @@ public:
     {
     public:
         LogTimer(MainContentComponent* owner) : owner(owner) {}
-        void timerCallback() override { owner->processLogEntries(); }
+        void timerCallback() override
+        {
+            owner->processLogEntries();
+            owner->showPressedNotes();
+            owner->showPedalButton();
+
+            if (owner->stuckNoteReaper.getMaxDurationMs() > 0)
+                owner->postCommand(Command::reapStuckNotes);
+
+            owner->updateStatus();
+        }
     private:
         MainContentComponent* owner;
     };
 
-    // Job class for background MIDI processing
-    class MidiProcessingJob : public juce::ThreadPoolJob
+    // One enabled MIDI input. Its device callback touches nothing but its own state and its own
+    // ring in the input merger.
+    class InputTap : public juce::MidiInputCallback
     {
     public:
-        MidiProcessingJob(MainContentComponent& owner, const juce::MidiMessage& msg)
-            : ThreadPoolJob("MIDI Processing"),
-            parent(owner),
-            message(msg)
+        InputTap(MainContentComponent& owner, int index, const juce::MidiDeviceInfo& device)
+            : owner(owner), index(index), device(device)
         {
         }
 
-        JobStatus runJob() override
+        void handleIncomingMidiMessage(juce::MidiInput*, const juce::MidiMessage& message) override
         {
-            // Only process non-critical messages here
-            if (!message.isNoteOnOrOff() &&
-                !message.isSostenutoPedalOn() &&
-                !message.isSostenutoPedalOff())
-            {
-                if (parent.midiOutput != nullptr)
-                    parent.midiOutput->sendMessageNow(message);
-            }
-            return JobStatus::jobHasFinished;
+            owner.handleInputMessage(*this, message);
         }
 
-    private:
-        MainContentComponent& parent;
-        juce::MidiMessage message;
+        void handlePartialSysexMessage(juce::MidiInput*, const juce::uint8* messageData, int numBytesSoFar, double timestamp) override
+        {
+            owner.handlePartialSysEx(*this, messageData, numBytesSoFar, timestamp);
+        }
+
+        MainContentComponent& owner;
+        const int index;
+        const juce::MidiDeviceInfo device;
+
+        // Input-side state of the SysEx dump arriving on this input - only touched from its
+        // callback (or with the callback removed)
+        bool sysexInProgress = false;
+        SysExStreamer::Dump sysexDump;
+        int sysexStreamed = 0;
+    };
+
+    // Looks like an ordinary device list, but opens a menu of devices to switch on and off
+    class DeviceListBox : public juce::ComboBox
+    {
+    public:
+        std::function<void()> onShowPopup;
+
+        void showPopup() override
+        {
+            if (onShowPopup)
+                onShowPopup();
+        }
     };
 
     MainContentComponent()
         : keyboardComponent(keyboardState, juce::MidiKeyboardComponent::horizontalKeyboard),
         startTime(juce::Time::getMillisecondCounterHiRes() * 0.001),
-        sostenutoPedalButton("\n\nSAUCE\n\n10\n\noO\n\ndough\n\n")
+        sostenutoPedalButton("\n\nSAUCE\n\n10\n\noO\n\ndough\n\n"),
+        pianoRoll(engineEvents),
+        outputScheduler(*this),
+        inputMerger(*this)
     {
         setOpaque(true);
 
         // Setup MIDI input components
         addAndMakeVisible(midiInputListLabel);
-        midiInputListLabel.setText("MIDI Input:", juce::dontSendNotification);
+        midiInputListLabel.setText("MIDI Inputs:", juce::dontSendNotification);
         midiInputListLabel.attachToComponent(&midiInputList, true);
 
         addAndMakeVisible(midiInputList);
-        midiInputList.setTextWhenNoChoicesAvailable("No MIDI Inputs Enabled");
+        midiInputList.setTextWhenNothingSelected("No MIDI Inputs Enabled");
+        midiInputList.onShowPopup = [this] { showInputMenu(); };
 
-        auto midiInputs = juce::MidiInput::getAvailableDevices();
-        juce::StringArray midiInputNames;
-        for (auto input : midiInputs)
-            midiInputNames.add(input.name);
+        // Merged input is processed on its own thread from here on
+        inputMerger.start();
 
-        midiInputList.addItemList(midiInputNames, 1);
-        midiInputList.onChange = [this] { setMidiInput(midiInputList.getSelectedItemIndex()); };
+        auto midiInputs = juce::MidiInput::getAvailableDevices();
 
         // Find the first enabled device and use that by default
         for (auto input : midiInputs)
         {
             if (deviceManager.isMidiInputDeviceEnabled(input.identifier))
             {
-                setMidiInput(midiInputs.indexOf(input));
+                toggleMidiInput(input);
                 break;
             }
         }
 
         // If no enabled devices were found just use the first one in the list
-        if (midiInputList.getSelectedId() == 0)
-            setMidiInput(0);
+        if (!midiInputs.isEmpty() && getNumEnabledInputs() == 0)
+            toggleMidiInput(midiInputs[0]);
 
         // Setup keyboard component
         addAndMakeVisible(keyboardComponent);
+        keyboardComponent.setSostenutoSource(publishedHeldBitmap);
         keyboardState.addListener(this);
 
         // Setup MIDI message display box
         addAndMakeVisible(midiMessagesBox);
-        midiMessagesBox.setMultiLine(true);
-        midiMessagesBox.setReturnKeyStartsNewLine(true);
-        midiMessagesBox.setReadOnly(true);
-        midiMessagesBox.setScrollbarsShown(true);
-        midiMessagesBox.setCaretVisible(false);
-        midiMessagesBox.setPopupMenuEnabled(true);
-        midiMessagesBox.setColour(juce::TextEditor::backgroundColourId, juce::Colour(0x32ffffff));
-        midiMessagesBox.setColour(juce::TextEditor::outlineColourId, juce::Colour(0x1c000000));
-        midiMessagesBox.setColour(juce::TextEditor::shadowColourId, juce::Colour(0x16000000));
-        StringArray fbf;
-        fbf.insert(0, Font::getDefaultMonospacedFontName());
-        Font fo(FontOptions("Consolas", 15, Font::plain));
-        fo.setPreferredFallbackFamilies(fbf);
-        midiMessagesBox.setFont(fo);
+        configureMessagesBox(midiMessagesBox);
 
         midiMessagesBox.insertTextAtCaret("          ||#|#|||#|#|#|||#|#||\n          ||w|e|||t|y|u|||o|p||\n          |aTsTd|fTgThTj|kTlT;|\n          |_|_|_|_|_|_|_|_|_|_|\nwill play keys on one type of keyboard with the other\n");
 
@@ -201,32 +262,102 @@ public:
             }
         };
 
+        // Setup piano roll toggle - the panel itself only becomes visible when enabled
+        addChildComponent(pianoRoll);
+        addAndMakeVisible(pianoRollButton);
+        pianoRollButton.setButtonText("Show Piano Roll");
+        pianoRollButton.setToggleState(false, juce::dontSendNotification);
+        pianoRollButton.onClick = [this] {
+            pianoRoll.setVisible(pianoRollButton.getToggleState());
+            resized();
+        };
+
+        // Setup running status toggle for DIN/serial-backed outputs - only offered on a byte-stream link
+        addAndMakeVisible(runningStatusButton);
+        runningStatusButton.setButtonText("Running Status (DIN)");
+        runningStatusButton.setToggleState(false, juce::dontSendNotification);
+        runningStatusButton.onClick = [this] {
+            wireEncoder.setRunningStatusEnabled(runningStatusButton.getToggleState());
+        };
+
+        // Setup sustain (CC64) and soft (CC67) emulation - off passes those controllers straight through
+        addAndMakeVisible(pedalEmulationButton);
+        pedalEmulationButton.setButtonText("Emulate Sustain/Soft");
+        pedalEmulationButton.setToggleState(false, juce::dontSendNotification);
+        pedalMapper.setPedalEnabled(PedalEngine::sustain, false);
+        pedalMapper.setPedalEnabled(PedalEngine::soft, false);
+        pedalEmulationButton.onClick = [this] {
+            const bool enabled = pedalEmulationButton.getToggleState();
+            pedalMapper.setPedalEnabled(PedalEngine::sustain, enabled);
+            pedalMapper.setPedalEnabled(PedalEngine::soft, enabled);
+
+            // Nothing may stay held by a pedal that is no longer being emulated
+            if (!enabled)
+                postCommand(Command::releaseEmulatedPedals);
+        };
+
+        // Setup output link model used to pace the output scheduler
+        addAndMakeVisible(linkModelListLabel);
+        linkModelListLabel.setText("Link:", juce::dontSendNotification);
+        linkModelListLabel.attachToComponent(&linkModelList, true);
+
+        addAndMakeVisible(linkModelList);
+        for (int i = 0; i < OutputScheduler::numLinkModels; ++i)
+            linkModelList.addItem(OutputScheduler::linkModels[i].name, i + 1);
+        linkModelList.setSelectedId(1, juce::dontSendNotification);
+        linkModelList.onChange = [this] { setLinkModel(linkModelList.getSelectedItemIndex()); };
+        setLinkModel(0);
+
+        addAndMakeVisible(sysExRateListLabel);
+        sysExRateListLabel.setText("SysEx:", juce::dontSendNotification);
+        sysExRateListLabel.attachToComponent(&sysExRateList, true);
+
+        addAndMakeVisible(sysExRateList);
+        for (int i = 0; i < OutputScheduler::numSysExRates; ++i)
+            sysExRateList.addItem(OutputScheduler::sysExRates[i].name, i + 1);
+        sysExRateList.setSelectedId(1, juce::dontSendNotification);
+        sysExRateList.onChange = [this] { outputScheduler.setSysExRate(sysExRateList.getSelectedItemIndex()); };
+
+        // Setup pedal source mapping (learn, inversion, hysteresis per pedal)
+        addAndMakeVisible(pedalMapButton);
+        pedalMapButton.setButtonText("Pedal Map...");
+        pedalMapButton.onClick = [this] { showPedalMapMenu(); };
+
+        // Setup panic button - note-offs only for what is actually sounding
+        addAndMakeVisible(panicButton);
+        panicButton.setButtonText("Panic");
+        panicButton.onClick = [this] {
+            loopDetector.resume(); // Also the way back after a feedback loop was cut
+            postCommand(Command::panic);
+        };
+
+        // Setup status line
+        addAndMakeVisible(statusLabel);
+        statusLabel.setJustificationType(juce::Justification::topLeft);
+        statusLabel.setFont(juce::Font(juce::FontOptions(12.0f)));
+        statusLabel.setColour(juce::Label::textColourId, juce::Colours::white.withAlpha(0.7f));
+
         // Setup sostenuto pedal button
         addAndMakeVisible(sostenutoPedalButton);
         sostenutoPedalButton.onClick = [this] { handleSostenutoPedalButton(); };
 
-        // Setup MIDI output components
+        // Setup MIDI output components - any number of destinations, each with a channel filter
         auto midiOutputs = juce::MidiOutput::getAvailableDevices();
 
         addAndMakeVisible(midiOutputListLabel);
-        midiOutputListLabel.setText("MIDI Output:", juce::dontSendNotification);
+        midiOutputListLabel.setText("MIDI Outputs:", juce::dontSendNotification);
         midiOutputListLabel.attachToComponent(&midiOutputList, true);
 
         addAndMakeVisible(midiOutputList);
-        midiOutputList.setTextWhenNoChoicesAvailable("No MIDI Outputs Available");
-
-        juce::StringArray midiOutputNames;
-        for (auto& output : midiOutputs)
-            midiOutputNames.add(output.name);
+        midiOutputList.setTextWhenNothingSelected("No MIDI Outputs Enabled");
+        midiOutputList.onShowPopup = [this] { showOutputMenu(); };
 
-        midiOutputList.addItemList(midiOutputNames, 1);
-        midiOutputList.onChange = [this] { setMidiOutput(midiOutputList.getSelectedItemIndex()); };
+        // Start with the first available output device
+        if (!midiOutputs.isEmpty())
+            toggleMidiOutput(midiOutputs[0]);
 
-        // Find and select the first available output device
-        setMidiOutput(0);
-
-        // Setup thread pool for background processing
-        configureThreadPool();
+        // Start pacing output
+        outputScheduler.start();
 
         // Setup log timer with configurable refresh rate
         logTimer = std::make_unique<LogTimer>(this);
@@ -239,15 +370,17 @@ public:
     ~MainContentComponent() override
     {
         logTimer->stopTimer();
-        midiThreadPool->removeAllJobs(true, 2000);
-        keyboardState.removeListener(this);
 
-        if (lastInputIndex >= 0 && lastInputIndex < juce::MidiInput::getAvailableDevices().size())
-            deviceManager.removeMidiInputDeviceCallback(
-                juce::MidiInput::getAvailableDevices()[lastInputIndex].identifier, this);
+        // No input may call in once the merge thread has gone
+        for (auto& tap : inputTaps)
+            if (tap != nullptr)
+                deviceManager.removeMidiInputDeviceCallback(tap->device.identifier, tap.get());
 
-        if (midiOutput)
-            midiOutput->stopBackgroundThread();
+        inputMerger.stop();
+        outputScheduler.stop();
+        silenceOutput(); // Nothing the app started may outlive it
+        keyboardState.removeListener(this);
+        // Each destination writes what is still queued for it as the router goes
     }
 
     void paint(juce::Graphics& g) override
@@ -280,6 +413,10 @@ public:
         auto keyboardArea = area.removeFromTop(80);
         keyboardComponent.setBounds(keyboardArea.reduced(8));
 
+        // Optional piano roll directly under the keyboard
+        if (pianoRoll.isVisible())
+            pianoRoll.setBounds(area.removeFromTop(pianoRollHeight).reduced(8, 0));
+
         // Remove space for the bottom controls
         auto bottomArea = area.removeFromBottom(pedalHeight + pedalMargin);
 
@@ -292,27 +429,110 @@ public:
         sostenutoPedalButton.setBounds(pedalX, pedalY, pedalWidth, pedalHeight);
         loggingEnabledButton.setBounds(pedalX + pedalWidth + 20, pedalY + (pedalHeight - checkboxHeight) / 2,
             checkboxWidth, checkboxHeight);
+        pianoRollButton.setBounds(loggingEnabledButton.getBounds().translated(0, checkboxHeight));
+        runningStatusButton.setBounds(loggingEnabledButton.getBounds().translated(0, -checkboxHeight));
+        panicButton.setBounds(pianoRollButton.getBounds().translated(0, checkboxHeight).withWidth(80));
+        statusLabel.setBounds(8, pedalY, juce::jmax(0, pedalX - 16), pedalHeight);
+        linkModelList.setBounds(getWidth() - linkModelWidth - 8, pedalY + 8, linkModelWidth, checkboxHeight);
+        sysExRateList.setBounds(linkModelList.getBounds().translated(0, checkboxHeight + 4));
+        pedalEmulationButton.setBounds(sysExRateList.getBounds().translated(0, checkboxHeight + 4));
+        pedalMapButton.setBounds(pedalEmulationButton.getBounds().translated(0, checkboxHeight + 4));
         sostenutoPedalButton.setMouseClickGrabsKeyboardFocus(false);
         loggingEnabledButton.setMouseClickGrabsKeyboardFocus(false);
+        pianoRollButton.setMouseClickGrabsKeyboardFocus(false);
+        runningStatusButton.setMouseClickGrabsKeyboardFocus(false);
+        pedalEmulationButton.setMouseClickGrabsKeyboardFocus(false);
+        pedalMapButton.setMouseClickGrabsKeyboardFocus(false);
+        panicButton.setMouseClickGrabsKeyboardFocus(false);
         midiMessagesBox.setMouseClickGrabsKeyboardFocus(false);
         keyboardComponent.grabKeyboardFocus();
     }
 
-    // Process incoming MIDI messages
-    void processMessageOnThread(const juce::MidiMessage& message)
+    // Shared by the app and the render benchmark so both draw the same log view
+    static void configureMessagesBox(juce::TextEditor& box)
     {
-        const juce::ScopedLock sl(midiProcessLock);
+        box.setMultiLine(true);
+        box.setReturnKeyStartsNewLine(true);
+        box.setReadOnly(true);
+        box.setScrollbarsShown(true);
+        box.setCaretVisible(false);
+        box.setPopupMenuEnabled(true);
+        box.setColour(juce::TextEditor::backgroundColourId, juce::Colour(0x32ffffff));
+        box.setColour(juce::TextEditor::outlineColourId, juce::Colour(0x1c000000));
+        box.setColour(juce::TextEditor::shadowColourId, juce::Colour(0x16000000));
+        StringArray fbf;
+        fbf.insert(0, Font::getDefaultMonospacedFontName());
+        Font fo(FontOptions("Consolas", 15, Font::plain));
+        fo.setPreferredFallbackFamilies(fbf);
+        box.setFont(fo);
+    }
 
-        // Handle time-critical messages immediately
-        if (message.isNoteOnOrOff() || (message.isController() && message.getControllerNumber() == 66))
-        {
-            processMidiRealTime(message);
-        }
-        else
+    // Refresh the status line - setText() only repaints when the text actually changes
+    void updateStatus()
+    {
+        const auto wireBytes = wireEncoder.getBytes();
+
+        juce::String status;
+
+        if (loopDetector.isCut())
+            status << "FEEDBACK LOOP: the output comes back on the input. Input cut - reroute, then press Panic\n";
+
+        status << "Out: " << juce::String(wireBytes) << " bytes ("
+            << juce::String(MidiWireEncoder::getDinWireTimeMs(wireBytes), 1) << " ms on DIN)";
+
+        if (outputError.isNotEmpty())
+            status << "\n" << outputError;
+
+        if (const auto coalesced = batchCoalescer.getDroppedCount() + outputScheduler.getCoalescedCount())
+            status << "\nCoalesced away " << juce::String(coalesced) << " stale values";
+
+        if (const auto overloads = ingress.getOverloadCount())
         {
-            // For non-time-critical messages, add to buffer for batch processing
-            midiMessageBuffer.addEvent(message, 0);
+            status << "\n" << (ingress.isOverloaded() ? "OVERLOAD - " : "") << "Coalesced " << juce::String(ingress.getCoalescedCount())
+                << " expression msgs in " << juce::String(overloads) << " overloads (ingress peak "
+                << juce::String(ingress.getPeakDepth()) << ")";
         }
+
+        if (const auto reordered = ingress.getFlushedAheadCount())
+            status << "\nFlushed " << juce::String(reordered) << " ahead of notes";
+
+        if (const auto lost = inputMerger.getDroppedCount())
+            status << "\nInput merge lost " << juce::String(lost) << " events";
+
+        if (const auto lost = outputRouter.getDroppedCount())
+            status << "\nSlow outputs dropped " << juce::String(lost) << " messages";
+
+        // Queueing delay per scheduler lane
+        const auto notes = outputScheduler.getStats(OutputScheduler::criticalLane);
+        const auto bulk = outputScheduler.getStats(OutputScheduler::bulkLane);
+        status << "\nNote-on delay " << juce::String(notes.meanDelayMs, 2) << " / " << juce::String(notes.maxDelayMs, 2) << " ms"
+            << "\nBulk delay " << juce::String(bulk.meanDelayMs, 2) << " / " << juce::String(bulk.maxDelayMs, 2) << " ms";
+
+        if (const auto sysexBytes = outputScheduler.getSysExBytes())
+            status << "\nSysEx sent " << juce::String((double)sysexBytes / 1024.0, 1) << " KB"
+                << " (" << juce::String(outputScheduler.getSysExDropped()) << " dumps dropped)";
+
+        if (const auto sounding = outputLedger.getNumSounding())
+            status << "\nSounding on output: " << juce::String(sounding);
+
+        if (const auto dropped = noteFilter.getDroppedCount())
+            status << "\nDropped " << juce::String(dropped) << " redundant note-offs";
+
+        if (const auto stolen = polyphonyBudget.getStolenCount())
+            status << "\nPolyphony limit ended " << juce::String(stolen) << " notes";
+
+        if (const auto reaped = stuckNoteReaper.getReapedCount())
+            status << "\nReleased " << juce::String(reaped) << " stuck notes";
+
+        if (const auto retriggered = noteFilter.getRetriggeredCount())
+            status << "\nRetriggered " << juce::String(retriggered) << " re-struck notes";
+
+        const auto clock = outputScheduler.getClockJitter();
+        if (clock.ticks > 0)
+            status << "\nClock jitter " << juce::String(clock.meanJitterMs, 3) << " / " << juce::String(clock.maxJitterMs, 3) << " ms";
+
+        statusLabel.setText(status, juce::dontSendNotification);
+        statusLabel.setColour(juce::Label::textColourId, ingress.isOverloaded() || loopDetector.isCut() ? juce::Colours::orange : juce::Colours::white.withAlpha(0.7f));
     }
 
     // Process and display log entries
@@ -363,168 +583,368 @@ public:
         }
     }
 
-private:
-    // Optimized for branchless comparison of MIDI message types
-    static juce::String getMidiMessageDescription(const juce::MidiMessage& m)
+    // UMP input, from any JUCE universal_midi_packets source (a U32ToUMPHandler, say) the host
+    // connects to this receiver. Call from one thread at a time: packets go through the merger's
+    // UMP ring, so the engine still only runs on the merge thread.
+    void packetReceived(const juce::universal_midi_packets::View& packet, double time) override
     {
-        juce::String result;
+        handleIncomingUmp(packet.data(), packet.size(), time);
+    }
 
-        // Pre-check properties to avoid multiple evaluations
-        const bool isNoteOn = m.isNoteOn();
-        const bool isNoteOff = m.isNoteOff();
-        const bool isProgramChange = m.isProgramChange();
-        const bool isPitchWheel = m.isPitchWheel();
-        const bool isAftertouch = m.isAftertouch();
-        const bool isChannelPressure = m.isChannelPressure();
-        const bool isAllNotesOff = m.isAllNotesOff();
-        const bool isAllSoundOff = m.isAllSoundOff();
-        const bool isMetaEvent = m.isMetaEvent();
-        const bool isController = m.isController();
+    // Packets are packed straight from their words, and MIDI 2.0 values keep their full
+    // resolution through the merge and the engine. SysEx7 and packets with no MIDI 1.0 equivalent
+    // (per-note controllers, RPN/NRPN) are ignored; all groups merge into one stream.
+    void handleIncomingUmp(const uint32_t* words, size_t numWords, double timeStamp)
+    {
+        const auto tick = PackedMidiEvent::secondsToTicks(timeStamp);
 
-        // Note handling with common shared code
-        if (isNoteOn || isNoteOff)
+        for (size_t i = 0; i < numWords; i += static_cast<size_t>(Ump::getNumWords(words[i])))
         {
-            result = (isNoteOn ? "Note on " : "Note off ") +
-                juce::MidiMessage::getMidiNoteName(m.getNoteNumber(), true, true, 3);
+            if (i + static_cast<size_t>(Ump::getNumWords(words[i])) > numWords)
+                break; // Truncated packet
 
-            return result;
-        }
+            PackedMidiEvent event;
+            uint32_t fullValue;
+            bool hasFullValue;
 
-        // Program change
-        if (isProgramChange)
-            return "Program change " + juce::String(m.getProgramChangeNumber());
+            if (!Ump::toEvent(words + i, tick, event, fullValue, hasFullValue))
+                continue;
 
-        // Pitch wheel
-        if (isPitchWheel)
-            return "Pitch wheel " + juce::String(m.getPitchWheelValue());
+            // A feedback loop was cut: this packet goes nowhere, and neither will the rest
+            if (loopDetector.isCut())
+                continue;
 
-        // Aftertouch
-        if (isAftertouch)
-            return "After touch " + juce::MidiMessage::getMidiNoteName(m.getNoteNumber(), true, true, 3) + ": " + juce::String(m.getAfterTouchValue());
+            // Real-time skips the engine, as it does from a MIDI input
+            if (event.isSystemRealTime())
+            {
+                sendToOutput(event);
+                continue;
+            }
 
-        // Channel pressure
-        if (isChannelPressure)
-            return "Channel pressure " + juce::String(m.getChannelPressureValue());
+            if (!inputMerger.pushUmp(event, fullValue, hasFullValue))
+                ingress.recordOverload();
+        }
+    }
 
-        // All notes off
-        if (isAllNotesOff)
-            return "All notes off";
+    // Pace the scheduler to a link, and offer running status only where it saves anything
+    void setLinkModel(int index)
+    {
+        outputScheduler.setLinkModel(index);
+        const bool isByteStream = outputScheduler.isByteStreamLink();
+        wireEncoder.setByteStreamLink(isByteStream);
+        runningStatusButton.setEnabled(isByteStream);
+    }
 
-        // All sound off
-        if (isAllSoundOff)
-            return "All sound off";
+    // Send everything to a UMP destination (any JUCE universal_midi_packets receiver) instead of
+    // the MIDI output devices (nullptr to stop)
+    void setUmpOutput(Ump::Receiver* output)
+    {
+        const juce::ScopedLock sl(outputLock);
+        silenceOutput();
+        umpOutput.store(output, std::memory_order_release);
+        umpSysExOpen = false;
+    }
 
-        // Meta event
-        if (isMetaEvent)
-            return "Meta event";
+private:
+    // Describe a journal entry straight from its packed bytes
+    static juce::String getMidiMessageDescription(const LogEntry& entry)
+    {
+        const auto& e = entry.event;
+
+        // SysEx is only ever logged by size
+        if (e.getStatus() == 0xf0)
+            return "SysEx, " + juce::String(entry.sysexBytes) + " bytes";
 
-        // Controller
-        if (isController)
+        switch (e.getStatus() < 0xf0 ? e.getType() : e.getStatus())
         {
-            juce::String name(juce::MidiMessage::getControllerName(m.getControllerNumber()));
+            // Note handling with common shared code
+            case 0x80:
+            case 0x90:
+                return (e.isNoteOn() ? "Note on " : "Note off ") +
+                    juce::MidiMessage::getMidiNoteName(e.getData1(), true, true, 3);
+
+            case 0xc0:
+                return "Program change " + juce::String(e.getData1());
+
+            case 0xe0:
+                return "Pitch wheel " + juce::String(e.getData1() | (e.getData2() << 7));
+
+            case 0xa0:
+                return "After touch " + juce::MidiMessage::getMidiNoteName(e.getData1(), true, true, 3) + ": " + juce::String(e.getData2());
+
+            case 0xd0:
+                return "Channel pressure " + juce::String(e.getData1());
+
+            case 0xb0:
+            {
+                if (e.getData1() == 123)
+                    return "All notes off";
+
+                if (e.getData1() == 120)
+                    return "All sound off";
 
-            // Branchless empty string check using ternary
-            name = name.isEmpty() ? "[" + juce::String(m.getControllerNumber()) + "]" : name;
+                juce::String name(juce::MidiMessage::getControllerName(e.getData1()));
 
-            return "Controller " + name + ": " + juce::String(m.getControllerValue());
+                // Branchless empty string check using ternary
+                name = name.isEmpty() ? "[" + juce::String(e.getData1()) + "]" : name;
+
+                return "Controller " + name + ": " + juce::String(e.getData2());
+            }
+
+            default:
+                break;
         }
 
         // Default - raw MIDI data as hex
-        return juce::String::toHexString(m.getRawData(), m.getRawDataSize());
+        const uint8_t raw[3] = { e.getStatus(), static_cast<uint8_t>(e.getData1()), static_cast<uint8_t>(e.getData2()) };
+        return juce::String::toHexString(raw, e.getSize());
     }
 
-    // Configure the thread pool for MIDI processing
-    void configureThreadPool()
+    juce::String getLogSourceName(const LogEntry& entry) const
     {
-        int numThreads = std::thread::hardware_concurrency();
-        if (numThreads == 0)
-            numThreads = 2; // Reasonable default
-
-        juce::ThreadPool::Options options;
-        options = options.withThreadName("MIDI Processing")
-            .withNumberOfThreads(numThreads);
+        switch (entry.source)
+        {
+            case LogSource::input:            return inputNames[entry.input] + " (Input)";
+            case LogSource::pedalButton:      return "Pedal Button";
+            case LogSource::onScreenKeyboard: return "On-Screen Keyboard";
+            case LogSource::heldByPedal:      return "On-Screen Keyboard (Held by Pedal)";
+            case LogSource::pedalRelease:     return "Pedal Release";
+            case LogSource::voiceStolen:      return "Polyphony Limit";
+            case LogSource::stuckNote:        return "Stuck Note";
+            case LogSource::ump:              return "UMP (Input)";
+        }
 
-        midiThreadPool = std::make_unique<juce::ThreadPool>(options);
+        return {};
     }
 
-    // Process MIDI messages
-    void processMidiMessage(const juce::MidiMessage& message)
+    // Overload control for the deferred lane, so no input device can grow it without bound.
+    // A full lane is first coalesced in place; if that leaves it over three quarters full, each new
+    // value overwrites the one it supersedes until the lane drains. Nothing is dropped: an event
+    // with no queued value to overwrite is deferred, and a lane that fills up all the same is
+    // pushed out whole from this thread.
+    void deferNonCritical(uint32_t sequence, const PackedMidiEvent& event)
     {
-        // Handle timing-critical messages first
-        if (message.isNoteOnOrOff() || (message.isController() && message.getControllerNumber() == 66))
+        const juce::ScopedLock sl(midiProcessLock);
+
+        if (ingress.isFull() && !ingress.isCoalescing())
+            ingress.compact([this](std::vector<SequencedMidiEvent>& lane) { batchCoalescer.compact(lane); });
+
+        if (ingress.isCoalescing())
         {
-            processMidiRealTime(message);
+            if (ingress.replace(sequence, event, MidiCoalescer::getKey))
+                return;
+
+            if (ingress.isFull())
+            {
+                ingress.recordOverload();
+                forwardNonCritical(batchCoalescer.process(ingress.takeAll()));
+            }
         }
-        else
+
+        ingress.defer(sequence, event);
+    }
+
+    // A SysEx dump is a barrier: everything deferred before it goes out first
+    void flushAllDeferred()
+    {
+        const juce::ScopedLock sl(midiProcessLock);
+
+        if (ingress.hasDeferred())
         {
-            // Add non-critical messages to processing queue
-            auto* job = new MidiProcessingJob(*this, message);
-            midiThreadPool->addJob(job, true);
+            for (const auto& message : batchCoalescer.process(ingress.takeAll()))
+                sendToOutput(message);
         }
+    }
 
-        // Add to log if enabled (separate path)
-        if (loggingEnabled)
-        {
-            const juce::ScopedLock sl(logMutex);
-            int start1, size1, start2, size2;
-            logFifo.prepareToWrite(1, start1, size1, start2, size2);
+    // Reorder rule: deferred events on this channel that arrived before a real-time event go out first
+    void flushDeferredAheadOf(int channel)
+    {
+        const juce::ScopedLock sl(midiProcessLock);
+        const auto& ahead = ingress.takeAheadOf(channel);
 
-            if (size1 + size2 > 0)
-            {
-                const int writeIndex = size1 == 1 ? start1 : start2;
-                logEntries[writeIndex] = { message, "MIDI", message.getTimeStamp() };
-                logFifo.finishedWrite(1);
-            }
+        if (!ahead.empty())
+        {
+            for (const auto& message : batchCoalescer.process(ahead))
+                sendToOutput(message);
         }
     }
 
     // Process real-time MIDI messages - MSVC optimized
-    void processMidiRealTime(const juce::MidiMessage& message)
+    // fullValue carries a MIDI 2.0 note's 16-bit velocity through to the output (0 if none)
+    void processMidiRealTime(const PackedMidiEvent& message, uint32_t fullValue = 0)
     {
+        // A mapped source drives its pedal - even a note, which then never sounds
+        PedalMapper::Change change;
+
+        if (pedalMapper.map(message, pedalEngine, change))
+        {
+            handlePedal(change.pedal, change.isDown, message.getChannel(), message.tick);
+            return;
+        }
+
         if (message.isNoteOnOrOff())
         {
-            // Always update keyboard state
-            keyboardState.processNextMidiEvent(message);
+            engineEvents.publishNote(message, false);
 
-            // For note-offs, check if held by sostenuto
-            if (message.isNoteOff())
+            if (message.isNoteOn())
             {
-                // Skip sending if held by sostenuto
-                if (isSostenutoPedalHeldNote(message.getNoteNumber()))
-                    return;
+                pedalEngine.noteOn(message.getChannel(), message.getData1());
+                publishPressedNotes(message.getChannel());
+                strikeTicks[message.getChannel() - 1][message.getData1()] = message.tick;
+
+                // Soft pedal scales the velocity on the way out, at whichever resolution it arrived
+                const auto velocity16 = fullValue != 0
+                    ? static_cast<uint32_t>(pedalEngine.scaleVelocity(message.getChannel(), static_cast<int>(fullValue), 0xffff))
+                    : 0u;
+
+                sendToOutput(PackedMidiEvent::make(message.getStatus(), message.getData1(),
+                    pedalEngine.scaleVelocity(message.getChannel(), message.getData2()), message.tick), velocity16);
+                return;
             }
 
-            // Send the note message
-            if (midiOutput != nullptr)
+            // Skip sending if a pedal holds the note
+            const bool shouldSend = pedalEngine.noteOff(message.getChannel(), message.getData1());
+            publishPressedNotes(message.getChannel());
+
+            if (!shouldSend)
             {
-                midiOutput->sendMessageNow(message);
+                polyphonyBudget.noteHeld(message.getChannel(), message.getData1());
+                publishHeldNotes();
+                return;
             }
+
+            // Send the note message
+            sendToOutput(message, fullValue);
         }
-        else // Must be sostenuto pedal message
+    }
+
+    // Pedal sources the engine consumes rather than forwards - one table lookup
+    bool isEmulatedPedal(const PackedMidiEvent& e) const
+    {
+        return pedalMapper.isMapped(e);
+    }
+
+    // Shared by MIDI input, the pedal button and the emulation toggle, all on the merge thread.
+    // Channel 0 means every channel. Values that do not change a pedal's state stop here, before
+    // any release or repaint.
+    void handlePedal(PedalEngine::Pedal pedal, bool isDown, int channel, uint32_t tick)
+    {
+        PedalEngine::Voices release;
+        const auto scope = channel == 0 ? PedalEngine::ALL_CHANNELS : pedalEngine.getScope(channel);
+        const auto changed = pedalEngine.setPedal(pedal, isDown, scope, release);
+
+        if (changed == 0)
+            return;
+
+        releaseNotes(release, tick);
+        publishHeldNotes();
+
+        // The piano roll and the pedal button show the sostenuto pedal on channel 1
+        if (pedal == PedalEngine::sostenuto && (changed & 1) != 0)
         {
-            const bool pedalDown = message.isSostenutoPedalOn();
-            const bool wasDown = sostenutoPedalButton.getToggleState();
+            engineEvents.publish(isDown ? EngineEvent::pedalDown : EngineEvent::pedalUp, 1, 66);
+            publishedSostenutoDown.store(isDown, std::memory_order_relaxed);
+        }
+    }
 
-            // Handle pedal state change
-            if (pedalDown && !wasDown) // Pedal pressed
-            {
-                // Capture all currently held notes
-                for (int note = 0; note < 128; ++note)
-                {
-                    if (keyboardState.isNoteOn(1, note))
-                    {
-                        setSostenutoPedalHeldNote(note);
-                    }
-                }
-            }
-            else if (!pedalDown && wasDown) // Pedal released
+    // Deferred events that must go out before a real-time event. A zone-wide MPE pedal can
+    // release voices on every member channel, so their last pitch bend and pressure go first.
+    void flushDeferredAheadOf(const PackedMidiEvent& event)
+    {
+        if (pedalEngine.isMpeMode() && isEmulatedPedal(event)
+            && pedalEngine.getScope(event.getChannel()) == PedalEngine::ALL_CHANNELS)
+            flushAllDeferred();
+        else
+            flushDeferredAheadOf(event.getChannel());
+    }
+
+    // One submenu per pedal: MIDI learn, inversion, hysteresis band and reset to the default CC
+    void showPedalMapMenu()
+    {
+        static const char* const pedalNames[] = { "Sustain", "Sostenuto", "Soft" };
+        static const char* const bandNames[] = { "None (64)", "Narrow (56-72)", "Wide (32-96)" };
+        static const int defaultControllers[] = { 64, 66, 67 };
+
+        juce::PopupMenu menu;
+
+        for (int p = 0; p < PedalEngine::numPedals; ++p)
+        {
+            const auto pedal = static_cast<PedalEngine::Pedal>(p);
+            const auto source = pedalMapper.getSource(pedal);
+            juce::PopupMenu sub;
+
+            sub.addItem("Learn from next CC, note or program change", [this, pedal] { pedalMapper.learn(pedal); });
+            sub.addItem("Inverted", true, source.inverted, [this, pedal, source] {
+                auto changed = source;
+                changed.inverted = !source.inverted;
+                pedalMapper.setSource(pedal, changed);
+            });
+
+            juce::PopupMenu bands;
+            for (int b = 0; b < PedalMapper::numHysteresisModes; ++b)
             {
-                handlePedalRelease(message.getTimeStamp());
+                bands.addItem(bandNames[b], source.type == PedalMapper::controllerSource, source.hysteresis == b,
+                    [this, pedal, source, b] {
+                        auto changed = source;
+                        changed.hysteresis = static_cast<PedalMapper::Hysteresis>(b);
+                        pedalMapper.setSource(pedal, changed);
+                    });
             }
 
-            // Update pedal button state
-            sostenutoPedalButton.handleCC66(message.getControllerValue());
+            sub.addSubMenu("Hysteresis", bands);
+            sub.addSeparator();
+            sub.addItem("Reset to CC" + juce::String(defaultControllers[p]), [this, pedal, p] {
+                pedalMapper.setSource(pedal, { PedalMapper::controllerSource, defaultControllers[p], false, PedalMapper::noHysteresis });
+            });
+
+            menu.addSubMenu(juce::String(pedalNames[p]) + ": " + pedalMapper.describe(pedal), sub);
+        }
+
+        juce::PopupMenu spreading;
+        for (const int ms : { 0, 5, 10, ReleaseSpreader::MAX_WINDOW_MS })
+        {
+            spreading.addItem(ms == 0 ? juce::String("Off") : juce::String(ms) + " ms", true, releaseSpreader.getWindowMs() == ms,
+                [this, ms] { releaseSpreader.setWindowMs(ms); });
+        }
+
+        spreading.addSeparator();
+        for (int o = 0; o < ReleaseSpreader::numOrders; ++o)
+        {
+            const auto order = static_cast<ReleaseSpreader::Order>(o);
+            spreading.addItem(ReleaseSpreader::getOrderName(order), true, releaseSpreader.getOrder() == order,
+                [this, order] { releaseSpreader.setOrder(order); });
+        }
+
+        juce::PopupMenu polyphony;
+        for (const int voices : { 0, 16, 32, 64, 128 })
+        {
+            polyphony.addItem(voices == 0 ? juce::String("Unlimited") : juce::String(voices) + " voices", true,
+                polyphonyBudget.getLimit() == voices, [this, voices] { polyphonyBudget.setLimit(voices); });
+        }
+
+        juce::PopupMenu watchdog;
+        for (const int seconds : { 0, 10, 30, 60, 300 })
+        {
+            const auto name = seconds == 0 ? juce::String("Never") : seconds < 60 ? juce::String(seconds) + " s" : juce::String(seconds / 60) + " min";
+            watchdog.addItem(name, true, stuckNoteReaper.getMaxDurationMs() == seconds * 1000,
+                [this, seconds] { stuckNoteReaper.setMaxDurationMs(seconds * 1000); });
         }
+
+        menu.addSeparator();
+        menu.addSubMenu("Polyphony limit", polyphony);
+        menu.addSubMenu("Release stuck notes after", watchdog);
+        menu.addSubMenu("Spread pedal releases", spreading);
+        menu.addItem("Retrigger re-struck held notes", true, noteFilter.isRetriggerEnabled(), [this] {
+            noteFilter.setRetriggerEnabled(!noteFilter.isRetriggerEnabled());
+        });
+        menu.addItem("MPE lower zone (master channel 1)", true, pedalEngine.isMpeMode(), [this] {
+            postCommand(Command::toggleMpe);
+        });
+
+        if (pedalMapper.isLearning())
+            menu.addItem("Cancel learn", [this] { pedalMapper.cancelLearn(); });
+
+        menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(pedalMapButton));
     }
 
     // Process batched MIDI messages
@@ -532,29 +952,27 @@ private:
     {
         const juce::ScopedLock sl(midiProcessLock);
 
-        juce::MidiBuffer::Iterator it(midiMessageBuffer);
-        juce::MidiMessage message;
-        int samplePosition;
+        // Only the latest value of each continuous stream is forwarded
+        forwardNonCritical(batchCoalescer.process(ingress.takeAll()));
+    }
 
-        while (it.getNextEvent(message, samplePosition))
-        {
-            // Process non-time-critical messages
-            if (!message.isNoteOnOrOff() &&
-                !message.isSostenutoPedalOn() &&
-                !message.isSostenutoPedalOff())
-            {
-                if (midiOutput)
-                    midiOutput->sendMessageNow(message);
-            }
-        }
+    // Classify the whole batch in one pass, then forward everything that is not time-critical
+    // (time-critical messages are sent directly in processMidiRealTime)
+    void forwardNonCritical(const std::vector<PackedMidiEvent>& batch)
+    {
+        batchClassifier.classify(batch.data(), batch.size());
 
-        midiMessageBuffer.clear();
+        // A mapped pedal source never reaches the deferred lane, so an unmapped CC66 here is an
+        // ordinary controller
+        constexpr uint32_t nonCritical = ~EventClassifier::classBit(EventClassifier::note);
+
+        batchClassifier.forEach(nonCritical, [this, &batch](size_t i) { sendToOutput(batch[i]); });
     }
 
     // Format a log entry - branchless optimization for string formatting
     juce::String formatLogEntry(const LogEntry& entry) const
     {
-        auto time = entry.timestamp - startTime;
+        auto time = PackedMidiEvent::ticksToSeconds(entry.event.tick) - startTime;
 
         // Use integer division and modulo for time components
         const int hours = static_cast<int>(time / 3600.0) % 24;
@@ -570,8 +988,8 @@ private:
         result
             << juce::String::formatted("%02d:%02d:%02d.%03d", hours, minutes, seconds, millis)
             << "  -  "
-            << getMidiMessageDescription(entry.message)
-            << " (" << entry.source << ")\n";
+            << getMidiMessageDescription(entry)
+            << " (" << getLogSourceName(entry) << ")\n";
 
         return result;
     }
@@ -615,323 +1033,804 @@ private:
         }
     }
 
-    // Set up MIDI input device
-    void setMidiInput(int index)
+    // Switch an input on or off; any number up to MidiInputMerger::MAX_INPUTS can be on at once
+    void toggleMidiInput(const juce::MidiDeviceInfo& device)
     {
-        auto list = juce::MidiInput::getAvailableDevices();
+        // Changing the inputs is one way out of a feedback loop
+        loopDetector.resume();
 
-        if (lastInputIndex >= 0 && lastInputIndex < list.size())
-            deviceManager.removeMidiInputDeviceCallback(list[lastInputIndex].identifier, this);
+        for (auto& tap : inputTaps)
+        {
+            if (tap != nullptr && tap->device.identifier == device.identifier)
+            {
+                deviceManager.removeMidiInputDeviceCallback(device.identifier, tap.get());
 
-        auto newInput = list[index];
+                // The callback is gone, so a dump it left unfinished can be dropped from here
+                abandonSysEx(*tap);
+                tap.reset();
+                updateInputListText();
+                return;
+            }
+        }
 
-        if (!deviceManager.isMidiInputDeviceEnabled(newInput.identifier))
-            deviceManager.setMidiInputDeviceEnabled(newInput.identifier, true);
+        for (int i = 0; i < MidiInputMerger::MAX_INPUTS; ++i)
+        {
+            if (inputTaps[i] == nullptr)
+            {
+                if (!deviceManager.isMidiInputDeviceEnabled(device.identifier))
+                    deviceManager.setMidiInputDeviceEnabled(device.identifier, true);
 
-        deviceManager.addMidiInputDeviceCallback(newInput.identifier, this);
-        midiInputList.setSelectedId(index + 1, juce::dontSendNotification);
+                inputNames[i] = device.name;
+                inputTaps[i] = std::make_unique<InputTap>(*this, i, device);
+                deviceManager.addMidiInputDeviceCallback(device.identifier, inputTaps[i].get());
+                break;
+            }
+        }
 
-        lastInputIndex = index;
+        updateInputListText();
     }
 
-    // Set up MIDI output device
-    void setMidiOutput(int index)
+    int getNumEnabledInputs() const
     {
-        auto list = juce::MidiOutput::getAvailableDevices();
+        int count = 0;
+        for (const auto& tap : inputTaps)
+            count += tap != nullptr ? 1 : 0;
+        return count;
+    }
 
-        if (index >= 0 && index < list.size())
-        {
-            midiOutput = nullptr; // Reset any existing output
+    void updateInputListText()
+    {
+        juce::StringArray names;
+        for (const auto& tap : inputTaps)
+            if (tap != nullptr)
+                names.add(tap->device.name);
 
-            midiOutput = juce::MidiOutput::openDevice(list[index].identifier);
+        midiInputList.setText(names.joinIntoString(" + "), juce::dontSendNotification);
+    }
 
-            if (midiOutput != nullptr)
-                midiOutput->startBackgroundThread();
+    void showInputMenu()
+    {
+        juce::PopupMenu menu;
+        const auto devices = juce::MidiInput::getAvailableDevices();
+        const bool isFull = getNumEnabledInputs() >= MidiInputMerger::MAX_INPUTS;
+
+        for (const auto& device : devices)
+        {
+            bool isEnabled = false;
+            for (const auto& tap : inputTaps)
+                isEnabled = isEnabled || (tap != nullptr && tap->device.identifier == device.identifier);
 
-            midiOutputList.setSelectedId(index + 1, juce::dontSendNotification);
+            menu.addItem(device.name, isEnabled || !isFull, isEnabled, [this, device] { toggleMidiInput(device); });
         }
+
+        if (devices.isEmpty())
+            menu.addItem("No MIDI Inputs Available", false, false, nullptr);
+
+        menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(midiInputList));
     }
 
-    // Handle async updates - simplified to reduce branching
-    void handleAsyncUpdate() override
+    // Start or stop sending the processed stream to an output device
+    void toggleMidiOutput(const juce::MidiDeviceInfo& device)
     {
-        // Process any batched messages first (direct access, no thread synchronization needed)
-        const juce::ScopedLock sl(midiProcessLock);
+        std::unique_ptr<OutputRouter::Destination> destination;
+
+        {
+            const juce::ScopedLock sl(outputLock);
+
+            if (auto* existing = outputRouter.find(device.identifier))
+            {
+                releaseOnDestination(*existing, OutputRouter::ALL_CHANNELS); // Notes left there would hang
+                destination = outputRouter.detach(device.identifier);
+            }
+        }
 
-        if (!midiMessageBuffer.isEmpty() && midiOutput != nullptr)
+        // Opening, and closing once its queue has drained, happen outside the lock so the
+        // other destinations keep playing
+        if (destination == nullptr)
         {
-            // Simple iteration without conditional branches inside the loop
-            juce::MidiBuffer::Iterator it(midiMessageBuffer);
-            juce::MidiMessage message;
-            int samplePosition;
+            destination = std::make_unique<OutputRouter::Destination>(device, OutputRouter::ALL_CHANNELS);
 
-            while (it.getNextEvent(message, samplePosition))
+            if (destination->isOpen())
             {
-                // Only send if this is not a time-critical message
-                // (time critical messages are sent directly in processMidiRealTime)
-                const bool isTimeCritical = message.isNoteOnOrOff() ||
-                    message.isSostenutoPedalOn() ||
-                    message.isSostenutoPedalOff();
-
-                if (!isTimeCritical)
-                    midiOutput->sendMessageNow(message);
+                const juce::ScopedLock sl(outputLock);
+                destination = outputRouter.attach(std::move(destination));
             }
 
-            // Clear buffer once done
-            midiMessageBuffer.clear();
+            // Still here: not attached, and destroyed below, outside the lock
+            outputError = destination == nullptr ? juce::String()
+                : (destination->isOpen() ? "No free output slot for " : "Could not open output ") + device.name;
         }
+
+        destination = nullptr;
+        updateOutputListText();
     }
 
-    // Handle sostenuto pedal button click
-    void handleSostenutoPedalButton()
+    // Change which channels a destination receives (bit 0 is channel 1)
+    void setOutputChannels(const juce::String& identifier, uint16_t channels)
     {
-        bool isDown = sostenutoPedalButton.getToggleState();
-        juce::MidiMessage message = juce::MidiMessage::controllerEvent(1, 66, isDown ? 127 : 0);
-        message.setTimeStamp(juce::Time::getMillisecondCounterHiRes() * 0.001);
+        const juce::ScopedLock sl(outputLock);
 
-        if (isDown) // Pedal just pressed
+        if (auto* destination = outputRouter.find(identifier))
         {
-            // Capture currently held notes
-            for (int note = 0; note < 128; ++note)
+            releaseOnDestination(*destination, destination->getChannels() & ~channels);
+            destination->setChannels(channels);
+        }
+    }
+
+    // Note-offs, to this destination only, for what it is still sounding on channels it is about
+    // to stop receiving. Call with outputLock held.
+    void releaseOnDestination(OutputRouter::Destination& destination, uint16_t channels)
+    {
+        outputLedger.forEachSounding(channels & destination.getChannels(), [&destination](int channel, int note) {
+            destination.push(PackedMidiEvent::noteOff(channel, note, 0));
+        });
+    }
+
+    void updateOutputListText()
+    {
+        midiOutputList.setText(outputRouter.getNames().joinIntoString(" + "), juce::dontSendNotification);
+    }
+
+    // One submenu per device: whether to send there, and the channels it receives
+    void showOutputMenu()
+    {
+        juce::PopupMenu menu;
+        const auto devices = juce::MidiOutput::getAvailableDevices();
+        const juce::ScopedLock sl(outputLock);
+
+        for (const auto& device : devices)
+        {
+            const auto* destination = outputRouter.find(device.identifier);
+            const bool isEnabled = destination != nullptr;
+            const uint16_t channels = isEnabled ? destination->getChannels() : 0;
+            const auto identifier = device.identifier;
+
+            juce::PopupMenu routing;
+            routing.addItem("Send to this output", isEnabled || !outputRouter.isFull(), isEnabled, [this, device] { toggleMidiOutput(device); });
+            routing.addSeparator();
+            routing.addItem("All channels", isEnabled, channels == OutputRouter::ALL_CHANNELS,
+                [this, identifier] { setOutputChannels(identifier, OutputRouter::ALL_CHANNELS); });
+
+            for (int c = 0; c < 16; ++c)
             {
-                if (keyboardState.isNoteOn(1, note))
-                    setSostenutoPedalHeldNote(note);
+                const auto bit = static_cast<uint16_t>(1 << c);
+                routing.addItem("Channel " + juce::String(c + 1), isEnabled, (channels & bit) != 0,
+                    [this, identifier, channels, bit] { setOutputChannels(identifier, static_cast<uint16_t>(channels ^ bit)); });
             }
+
+            menu.addSubMenu(device.name, routing, true, nullptr, isEnabled);
+        }
+
+        if (devices.isEmpty())
+            menu.addItem("No MIDI Outputs Available", false, false, nullptr);
+
+        menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(midiOutputList));
+    }
+
+    // Single exit point for processed messages - the scheduler decides when they hit the wire
+    void sendToOutput(const PackedMidiEvent& message, uint32_t fullValue = 0)
+    {
+        PackedMidiEvent stolenVoice; // Goes out just ahead of this note-on, if it ends a voice
+
+        if (message.isNoteOn())
+            stolenVoice = enforcePolyphonyLimit(message);
+        else if (message.isNoteOff())
+            polyphonyBudget.noteOff(message.getChannel(), message.getData1());
+
+        if (message.isNoteOnOrOff())
+            engineEvents.publishNote(message, true);
+
+        if (outputScheduler.enqueue(message, fullValue, stolenVoice))
+            return;
+
+        // Real-time bytes may come from a device callback, which must not wait; with the lane
+        // full the output is far behind, and a clock byte more or less no longer matters
+        if (message.isSystemRealTime())
+        {
+            ingress.recordOverload();
+            return;
+        }
+
+        // Lane full: the output cannot keep up. Latest-value data has already been coalesced into
+        // any value still queued for it, so wait for room - writing it directly would overtake
+        // what is already queued
+        ingress.recordOverload();
+        outputScheduler.enqueueWaiting(message, fullValue, stolenVoice);
+    }
+
+    // A note-on over the polyphony limit first ends the longest pedal-held (or oldest) note.
+    // Returns that note's note-off for the scheduler to send ahead of the note-on, or an empty
+    // event if there is room.
+    PackedMidiEvent enforcePolyphonyLimit(const PackedMidiEvent& noteOn)
+    {
+        PolyphonyBudget::Voice victim;
+
+        if (!polyphonyBudget.admitNoteOn(noteOn.getChannel(), noteOn.getData1(), pedalEngine, victim))
+            return {};
+
+        pedalEngine.forget(victim.channel, victim.note);
+        publishPressedNotes(victim.channel);
+        publishHeldNotes();
+
+        const auto noteOff = PackedMidiEvent::noteOff(victim.channel, victim.note, noteOn.tick);
+        engineEvents.publishNote(noteOff, true);
+        logEvent(noteOff, LogSource::voiceStolen);
+        return noteOff;
+    }
+
+    // Release notes sounding longer than the watchdog allows - unless a pedal is holding them,
+    // which earns them another full duration. Merge thread, when the log timer asks.
+    void reapStuckNotes()
+    {
+        stuckNoteReaper.advance([this](int channel, int note) {
+            if (pedalEngine.isHeldByPedal(channel, note))
+                return false;
+
+            // Its note-off was lost: forget the key too, or a later sostenuto would catch it
+            pedalEngine.forget(channel, note);
+            publishPressedNotes(channel);
+
+            const auto noteOff = PackedMidiEvent::noteOff(channel, note, PackedMidiEvent::ticksNow());
+            sendToOutput(noteOff);
+            logEvent(noteOff, LogSource::stuckNote);
+            return true;
+        });
+    }
+
+    // OutputScheduler::Sink implementation, called from the scheduler thread.
+    // This is the device boundary - the only place a packed event becomes a MidiMessage (or,
+    // for a UMP destination, a packet) again.
+    void writeMessage(const PackedMidiEvent& event, uint32_t fullValue) override
+    {
+        const juce::ScopedLock sl(outputLock);
+
+        // Checked against what is sounding now, after any reordering the scheduler did
+        switch (noteFilter.process(event, outputLedger))
+        {
+            case NoteOutputFilter::Action::drop:
+                return;
+
+            case NoteOutputFilter::Action::retrigger:
+                writeToOutput(PackedMidiEvent::noteOff(event.getChannel(), event.getData1(), event.tick), 0);
+                break;
+
+            case NoteOutputFilter::Action::pass:
+                break;
+        }
+
+        writeToOutput(event, fullValue);
+    }
+
+    // Past the filter: record the note and write it to whichever destination is attached
+    void writeToOutput(const PackedMidiEvent& event, uint32_t fullValue)
+    {
+        const juce::ScopedLock sl(outputLock);
+        outputLedger.update(event);
+        loopDetector.recordSent(event);
+
+        if (event.isNoteOn())
+            stuckNoteReaper.arm(event.getChannel(), event.getData1());
+        else if (event.isNoteOff())
+            stuckNoteReaper.cancel(event.getChannel(), event.getData1());
+
+        if (auto* ump = umpOutput.load(std::memory_order_acquire))
+        {
+            uint32_t words[2];
+            Ump::fromEvent(event, fullValue, words);
+            Ump::send(*ump, words, PackedMidiEvent::ticksToSeconds(event.tick));
+            return;
+        }
+
+        writeToDevice(wireEncoder.prepare(event));
+    }
+
+    // True while the inputs are cut. The event that completes a loop cuts it, drops whatever
+    // echoes are still waiting in the deferred lane and silences the output.
+    bool isFeedbackLoop(const PackedMidiEvent& event)
+    {
+        if (loopDetector.isCut())
+            return true;
+
+        if (!loopDetector.isEchoLoop(event))
+            return false;
+
+        // Each input drops its own unfinished dump when it next calls in
+
+        {
+            const juce::ScopedLock sl(midiProcessLock);
+            ingress.takeAll();
+        }
+
+        panic();
+        return true;
+    }
+
+    // Note-offs for exactly the notes left sounding on the outputs, straight to the devices
+    void silenceOutput()
+    {
+        const juce::ScopedLock sl(outputLock);
+
+        outputLedger.releaseAll([this](int channel, int note) {
+            writeToOutput(PackedMidiEvent::noteOff(channel, note, PackedMidiEvent::ticksNow()), 0);
+        });
+
+        polyphonyBudget.reset();
+    }
+
+    // Silence the output and forget everything pedals were holding. Notes still queued for the
+    // output are dropped first, or they would sound after the silence. Merge thread only.
+    void panic()
+    {
+        outputScheduler.discardQueuedNotes();
+        silenceOutput();
+        pedalEngine.reset();
+        publishHeldNotes();
+
+        for (int channel = 1; channel <= 16; ++channel)
+            publishPressedNotes(channel);
+
+        publishedSostenutoDown.store(false, std::memory_order_relaxed);
+    }
+
+    bool writeSysEx(const uint8_t* data, int size) override
+    {
+        const juce::ScopedLock sl(outputLock);
+
+        if (auto* ump = umpOutput.load(std::memory_order_acquire))
+        {
+            Ump::forEachSysEx7Packet(data, size, umpSysExOpen,
+                [ump](const uint32_t* words) { Ump::send(*ump, words, juce::Time::getMillisecondCounterHiRes() * 0.001); });
+            return true;
         }
-        else // Pedal just released
+
+        if (!outputRouter.writeSysEx(data, size))
+            return false;
+
+        wireEncoder.count(size);
+        return true;
+    }
+
+    void writeToDevice(const PackedMidiEvent& wireEvent)
+    {
+        // Serialised so every destination receives the messages in one order
+        const juce::ScopedLock sl(outputLock);
+        wireEncoder.count(wireEvent.getSize());
+        outputRouter.write(wireEvent); // Never blocks - each destination has its own writer
+    }
+
+    // Handle async updates - simplified to reduce branching
+    void handleAsyncUpdate() override
+    {
+        // Process any batched messages first (direct access, no thread synchronization needed)
+        const juce::ScopedLock sl(midiProcessLock);
+
+        if (ingress.hasDeferred())
         {
-            handlePedalRelease(message.getTimeStamp());
+            // Stale pitch-wheel / controller values are dropped before forwarding
+            forwardNonCritical(batchCoalescer.process(ingress.takeAll()));
         }
+    }
+
+    // Handle sostenuto pedal button click - played as CC66 on channel 1
+    void handleSostenutoPedalButton()
+    {
+        const bool isDown = sostenutoPedalButton.getToggleState();
+        postCommand(Command::pedalButton, PackedMidiEvent::controller(1, 66, isDown ? 127 : 0, PackedMidiEvent::ticksNow()));
+    }
+
+    // Merge thread: the pedal button's CC
+    void playPedalButton(const PackedMidiEvent& message)
+    {
+        ingress.next();
+        flushDeferredAheadOf(message);
+        handlePedal(PedalEngine::sostenuto, message.getData2() >= 64, 1, message.tick);
 
         // Send CC message
-        if (midiOutput)
-            midiOutput->sendMessageNow(message);
+        sendToOutput(message);
+        logEvent(message, LogSource::pedalButton);
+    }
+
+    // Message thread: the pedal button follows the sostenuto pedal on channel 1 - but only when
+    // the engine's state changes, so a click still on its way to the engine is not undone
+    void showPedalButton()
+    {
+        const bool isDown = publishedSostenutoDown.load(std::memory_order_relaxed);
+
+        if (isDown == shownSostenutoDown)
+            return;
+
+        shownSostenutoDown = isDown;
+        sostenutoPedalButton.setPedalDown(isDown);
+    }
 
-        // Log the action
-        if (loggingEnabled)
+    // An input's device callback: no lock and no engine work. The message is packed and handed
+    // to the merge thread through this input's own ring.
+    void handleInputMessage(InputTap& tap, const juce::MidiMessage& message)
+    {
+        // Everything but SysEx is packed once here and never re-decoded downstream
+        const bool isSysEx = message.isSysEx();
+
+        if (!isSysEx && !PackedMidiEvent::canPack(message))
+            return;
+
+        // A feedback loop was cut: nothing from any input goes anywhere
+        if (loopDetector.isCut())
+        {
+            abandonSysEx(tap);
+            return;
+        }
+
+        if (isSysEx)
         {
-            const juce::ScopedLock sl(logMutex);
-            int start1, size1, start2, size2;
-            logFifo.prepareToWrite(1, start1, size1, start2, size2);
+            // Copied into the scheduler's SysEx arena straight from here, never via the message
+            // thread. Only the arena blocks travel through the merge, which queues the dump behind
+            // everything this input sent before it.
+            SysExStreamer::Dump dump;
 
-            if (size1 + size2 > 0)
+            if (finishSysEx(tap, message, dump)
+                && !inputMerger.push(tap.index, PackedMidiEvent::make(0xf0, 0, 0, PackedMidiEvent::secondsToTicks(message.getTimeStamp())), dump))
             {
-                const int writeIndex = size1 == 1 ? start1 : start2;
-                logEntries[writeIndex] = { message, "Pedal Button", message.getTimeStamp() };
-                logFifo.finishedWrite(1);
+                outputScheduler.discardSysEx(dump);
+                ingress.recordOverload();
             }
+
+            return;
+        }
+
+        const auto event = PackedMidiEvent::fromMidiMessage(message);
+
+        // System real-time (clock, transport, active sensing) skips the engine entirely and goes
+        // straight to the scheduler's real-time lane. It takes no part in ingress ordering, and
+        // is not logged - a running clock alone would push 24 lines per beat into the log view.
+        if (event.isSystemRealTime())
+        {
+            sendToOutput(event);
+            return;
         }
+
+        // Any other status byte ends an unfinished dump from this input
+        abandonSysEx(tap);
+
+        if (!inputMerger.push(tap.index, event))
+            ingress.recordOverload();
     }
 
-    // MidiInputCallback implementation - direct processing with minimal branching
-    void handleIncomingMidiMessage(juce::MidiInput* source, const juce::MidiMessage& message) override
+    // MidiInputMerger::Consumer implementation, called on the merge thread in timestamp order
+    void processMergedEvent(const MidiInputMerger::Item& item) override
     {
-        // Process message directly - no FIFO needed for such a simple operation
-        isAddingFromMidiInput = true;
+        const auto& event = item.event;
+
+        if (item.input == MidiInputMerger::COMMAND_INPUT)
+        {
+            runCommand(static_cast<Command>(item.command), event);
+            return;
+        }
+
+        // Our own output coming back: once recognised, nothing from any input goes anywhere
+        if (isFeedbackLoop(event))
+        {
+            auto dump = item.sysex;
+            outputScheduler.discardSysEx(dump);
+            return;
+        }
+
+        // While learning, the first usable message becomes the pedal source and goes no further
+        if (pedalMapper.learnFrom(event))
+            return;
+
+        // Every event takes its place in the single ingress order, whichever lane handles it
+        const auto sequence = ingress.next();
 
         // High-priority path: For time-critical messages, process immediately
-        if (message.isNoteOnOrOff() || message.isSostenutoPedalOn() || message.isSostenutoPedalOff())
+        if (event.isNoteOnOrOff() || isEmulatedPedal(event))
         {
-            processMidiRealTime(message);
+            flushDeferredAheadOf(event);
+            processMidiRealTime(event, item.fullValue);
+        }
+        else if (item.hasFullValue)
+        {
+            // The deferred lane's coalescer keeps 7-bit events only, so every MIDI 2.0 value -
+            // 0 included, or it would land out of order - goes straight out behind whatever is
+            // already waiting on its channel
+            flushDeferredAheadOf(event.getChannel());
+            sendToOutput(event, item.fullValue);
+        }
+        else if (event.getStatus() == 0xf0)
+        {
+            // A dump is a barrier: everything deferred before it goes out first. Its bytes are
+            // already in the arena; only its place in the output order is taken here.
+            auto dump = item.sysex;
+            flushAllDeferred();
+            outputScheduler.enqueueSysExWaiting(dump);
         }
         else
         {
-            // Low-priority path: For other messages, add to buffer for batch processing
-            const juce::ScopedLock sl(midiProcessLock);
-            midiMessageBuffer.addEvent(message, 0);
+            // Low-priority path: For other messages, add to the deferred lane for batch processing
+            deferNonCritical(sequence, event);
             triggerAsyncUpdate();
         }
 
-        // Add to logging system if enabled (non-blocking)
-        if (loggingEnabled.load(std::memory_order_relaxed))
+        logEvent(event, item.input == MidiInputMerger::UMP_INPUT ? LogSource::ump : LogSource::input,
+            item.sysex.size, item.input);
+    }
+
+    // Merge thread: what the message thread asked for, in its place in the input order
+    void runCommand(Command command, const PackedMidiEvent& event)
+    {
+        switch (command)
         {
-            // Try to add to log FIFO - if full, simply drop the message
-            int start1, size1, start2, size2;
-            logFifo.prepareToWrite(1, start1, size1, start2, size2);
+            case Command::keyboardNote:
+                playKeyboardNote(event);
+                break;
 
-            if (size1 + size2 > 0)
-            {
-                const int writeIndex = size1 == 1 ? start1 : start2;
-                logEntries[writeIndex] = { message, source->getName() + " (Input)", message.getTimeStamp() };
-                logFifo.finishedWrite(1);
-            }
+            case Command::pedalButton:
+                playPedalButton(event);
+                break;
+
+            case Command::reapStuckNotes:
+                reapStuckNotes();
+                break;
+
+            case Command::panic:
+                panic();
+                break;
+
+            case Command::releaseEmulatedPedals:
+                handlePedal(PedalEngine::sustain, false, 0, event.tick);
+                handlePedal(PedalEngine::soft, false, 0, event.tick);
+                break;
+
+            case Command::toggleMpe:
+                // Pedal scopes change with the mode, so nothing may stay held across the switch
+                for (int p = 0; p < PedalEngine::numPedals; ++p)
+                    handlePedal(static_cast<PedalEngine::Pedal>(p), false, 0, event.tick);
+
+                pedalEngine.setMpeMode(!pedalEngine.isMpeMode());
+                break;
         }
+    }
 
-        isAddingFromMidiInput = false;
+    // Message thread: hand the engine work to the merge thread. A full command ring means the
+    // merge thread has stalled, and counts as overload like a full input ring.
+    void postCommand(Command command, const PackedMidiEvent& event = PackedMidiEvent::make(0, 0, 0, PackedMidiEvent::ticksNow()))
+    {
+        if (!inputMerger.pushCommand(static_cast<uint8_t>(command), event))
+            ingress.recordOverload();
     }
 
-    // MidiKeyboardStateListener implementation for note on
-    void handleNoteOn(juce::MidiKeyboardState*, int midiChannel, int midiNoteNumber, float velocity) override
+    // Merge thread only, which makes it the log FIFO's single producer. A full FIFO drops the entry.
+    void logEvent(const PackedMidiEvent& event, LogSource source, int sysexBytes = 0, uint8_t input = 0)
     {
-        if (!isAddingFromMidiInput)
+        if (!loggingEnabled.load(std::memory_order_relaxed))
+            return;
+
+        int start1, size1, start2, size2;
+        logFifo.prepareToWrite(1, start1, size1, start2, size2);
+
+        if (size1 + size2 > 0)
         {
-            auto m = juce::MidiMessage::noteOn(midiChannel, midiNoteNumber, velocity);
-            m.setTimeStamp(juce::Time::getMillisecondCounterHiRes() * 0.001);
+            const int writeIndex = size1 == 1 ? start1 : start2;
+            logEntries[writeIndex] = { event, source, sysexBytes, input };
+            logFifo.finishedWrite(1);
+        }
+    }
 
-            // Send MIDI message
-            if (midiOutput)
-                midiOutput->sendMessageNow(m);
+    // SysEx still arriving: copy what is here so far into the arena. Nothing goes out until the
+    // dump is complete.
+    void handlePartialSysEx(InputTap& tap, const juce::uint8* messageData, int numBytesSoFar, double /*timestamp*/)
+    {
+        if (loopDetector.isCut())
+            return;
 
-            // Add to log if enabled
-            if (loggingEnabled)
-            {
-                const juce::ScopedLock sl(logMutex);
-                int start1, size1, start2, size2;
-                logFifo.prepareToWrite(1, start1, size1, start2, size2);
+        if (!tap.sysexInProgress)
+            beginSysEx(tap);
 
-                if (size1 + size2 > 0)
-                {
-                    const int writeIndex = size1 == 1 ? start1 : start2;
-                    logEntries[writeIndex] = { m, "On-Screen Keyboard", m.getTimeStamp() };
-                    logFifo.finishedWrite(1);
-                }
-            }
+        const int available = numBytesSoFar - tap.sysexStreamed;
+
+        if (available >= SysExStreamer::MIN_PARTIAL_BYTES)
+            tap.sysexStreamed += outputScheduler.writeSysEx(tap.sysexDump, messageData + tap.sysexStreamed, available);
+    }
+
+    // SysEx state is per input and only touched from its callback (or with the callback removed)
+    void beginSysEx(InputTap& tap)
+    {
+        tap.sysexDump = {};
+        tap.sysexStreamed = 0;
+        tap.sysexInProgress = true;
+    }
+
+    // Completes the dump into the arena and hands it over in dump, or returns false if it had
+    // to be dropped
+    bool finishSysEx(InputTap& tap, const juce::MidiMessage& message, SysExStreamer::Dump& dump)
+    {
+        if (!tap.sysexInProgress)
+            beginSysEx(tap);
+
+        tap.sysexInProgress = false;
+        const int remaining = message.getRawDataSize() - tap.sysexStreamed;
+
+        // Too big for what is left of the arena: drop it whole rather than send part of it
+        if (outputScheduler.writeSysEx(tap.sysexDump, message.getRawData() + tap.sysexStreamed, remaining) < remaining)
+        {
+            outputScheduler.discardSysEx(tap.sysexDump);
+            return false;
         }
+
+        dump = tap.sysexDump;
+        tap.sysexDump = {};
+        return true;
     }
 
-    // MidiKeyboardStateListener implementation for note off
+    // Drop a dump whose end will never come; none of it has reached the output
+    void abandonSysEx(InputTap& tap)
+    {
+        if (!tap.sysexInProgress)
+            return;
+
+        outputScheduler.discardSysEx(tap.sysexDump);
+        tap.sysexInProgress = false;
+    }
+
+    // MidiKeyboardStateListener implementation for note on - played on the merge thread
+    void handleNoteOn(juce::MidiKeyboardState*, int midiChannel, int midiNoteNumber, float velocity) override
+    {
+        if (!isAddingFromMidiInput)
+            postCommand(Command::keyboardNote, PackedMidiEvent::noteOn(midiChannel, midiNoteNumber,
+                juce::jlimit(1, 127, juce::roundToInt(velocity * 127.0f)), PackedMidiEvent::ticksNow()));
+    }
+
+    // MidiKeyboardStateListener implementation for note off - played on the merge thread
     void handleNoteOff(juce::MidiKeyboardState*, int midiChannel, int midiNoteNumber, float /*velocity*/) override
     {
         if (!isAddingFromMidiInput)
+            postCommand(Command::keyboardNote, PackedMidiEvent::noteOff(midiChannel, midiNoteNumber, PackedMidiEvent::ticksNow()));
+    }
+
+    // Merge thread: an on-screen key
+    void playKeyboardNote(const PackedMidiEvent& event)
+    {
+        const int midiChannel = event.getChannel();
+        const int midiNoteNumber = event.getData1();
+
+        ingress.next();
+        flushDeferredAheadOf(midiChannel);
+
+        if (event.isNoteOn())
         {
-            auto m = juce::MidiMessage::noteOff(midiChannel, midiNoteNumber);
-            m.setTimeStamp(juce::Time::getMillisecondCounterHiRes() * 0.001);
+            const auto m = PackedMidiEvent::noteOn(midiChannel, midiNoteNumber,
+                pedalEngine.scaleVelocity(midiChannel, event.getData2()), event.tick);
+            pedalEngine.noteOn(midiChannel, midiNoteNumber);
+            publishPressedNotes(midiChannel);
+            strikeTicks[midiChannel - 1][midiNoteNumber] = m.tick;
 
-            // Skip if held by sostenuto
-            if (isSostenutoPedalHeldNote(midiNoteNumber))
-            {
-                if (loggingEnabled)
-                {
-                    const juce::ScopedLock sl(logMutex);
-                    int start1, size1, start2, size2;
-                    logFifo.prepareToWrite(1, start1, size1, start2, size2);
-
-                    if (size1 + size2 > 0)
-                    {
-                        const int writeIndex = size1 == 1 ? start1 : start2;
-                        logEntries[writeIndex] = { m, "On-Screen Keyboard (Held by Sostenuto)", m.getTimeStamp() };
-                        logFifo.finishedWrite(1);
-                    }
-                }
-                return;
-            }
+            // Send MIDI message
+            engineEvents.publishNote(m, false);
+            sendToOutput(m);
+            logEvent(m, LogSource::onScreenKeyboard);
+            return;
+        }
 
-            // Send note-off
-            if (midiOutput)
-                midiOutput->sendMessageNow(m);
+        engineEvents.publishNote(event, false);
 
-            // Add to log if enabled
-            if (loggingEnabled)
-            {
-                const juce::ScopedLock sl(logMutex);
-                int start1, size1, start2, size2;
-                logFifo.prepareToWrite(1, start1, size1, start2, size2);
+        // Skip if held by a pedal
+        const bool shouldSend = pedalEngine.noteOff(midiChannel, midiNoteNumber);
+        publishPressedNotes(midiChannel);
 
-                if (size1 + size2 > 0)
-                {
-                    const int writeIndex = size1 == 1 ? start1 : start2;
-                    logEntries[writeIndex] = { m, "On-Screen Keyboard", m.getTimeStamp() };
-                    logFifo.finishedWrite(1);
-                }
-            }
+        if (!shouldSend)
+        {
+            polyphonyBudget.noteHeld(midiChannel, midiNoteNumber);
+            publishHeldNotes();
+            logEvent(event, LogSource::heldByPedal);
+            return;
         }
+
+        // Send note-off
+        sendToOutput(event);
+        logEvent(event, LogSource::onScreenKeyboard);
     }
 
-    // Sostenuto pedal note handling
-    // Branchless sostenuto note setting
-    constexpr inline void setSostenutoPedalHeldNote(int note)
+    // Make the pedal-held notes visible to the keyboard view without locking
+    void publishHeldNotes()
     {
-        // Only perform operation if note is in valid range, without branching
-        const bool isValidNote = (note >= 0 && note < 128);
-        const size_t index = note / 64;
-        const size_t bit = note % 64;
-
-        // This will have no effect if isValidNote is false (out of range)
-        sostenutoPedalHeldNotesBitmap[index] |= isValidNote * (1ULL << bit);
+        publishedHeldBitmap[0].store(pedalEngine.getHeldBits(0), std::memory_order_release);
+        publishedHeldBitmap[1].store(pedalEngine.getHeldBits(1), std::memory_order_release);
     }
 
-    // Branchless sostenuto note clearing
-    constexpr inline void clearSostenutoPedalHeldNote(int note)
+    // Keys down on one channel, for the on-screen keyboard. Two stores, where updating the
+    // keyboard state itself would lock and notify listeners from the real-time path.
+    void publishPressedNotes(int channel)
     {
-        // Only perform operation if note is in valid range, without branching
-        const bool isValidNote = (note >= 0 && note < 128);
-        const size_t index = note / 64;
-        const size_t bit = note % 64;
-
-        // This will have no effect if isValidNote is false (out of range)
-        sostenutoPedalHeldNotesBitmap[index] &= ~(isValidNote * (1ULL << bit));
+        const int c = (channel - 1) & 0x0f;
+        publishedPressedBitmap[c][0].store(pedalEngine.getPressedBits(channel, 0), std::memory_order_relaxed);
+        publishedPressedBitmap[c][1].store(pedalEngine.getPressedBits(channel, 1), std::memory_order_relaxed);
     }
 
-    // Branchless implementation of sostenuto note check
-    constexpr inline bool isSostenutoPedalHeldNote(int note) const
+    // Message thread, from the log timer: bring the on-screen keyboard in line with the keys
+    // the engine has down, touching only keys that changed since the last call
+    void showPressedNotes()
     {
-        // Use arithmetic to avoid branching
-        // This evaluates to 0 if note is out of range, allowing the rest of the expression to be safe
-        return (note >= 0 && note < 128) &&
-            ((sostenutoPedalHeldNotesBitmap[note / 64] & (1ULL << (note % 64))) != 0);
-    }
+        isAddingFromMidiInput = true; // Not fed back to the engine as on-screen playing
+
+        for (int c = 0; c < 16; ++c)
+        {
+            for (int k = 0; k < 2; ++k)
+            {
+                const uint64_t pressed = publishedPressedBitmap[c][k].load(std::memory_order_relaxed);
 
-    void resetSostenutoPedalHeldNotes() {
-        sostenutoPedalHeldNotesBitmap[0] = 0;
-        sostenutoPedalHeldNotesBitmap[1] = 0;
+                for (uint64_t changed = pressed ^ shownPressedBitmap[c][k]; changed != 0; changed &= changed - 1)
+                {
+                    const int bit = countTrailingZeros(changed);
+                    const int note = k * 64 + bit;
+
+                    if ((pressed >> bit & 1) != 0)
+                        keyboardState.noteOn(c + 1, note, 1.0f);
+                    else
+                        keyboardState.noteOff(c + 1, note, 0.0f);
+                }
+
+                shownPressedBitmap[c][k] = pressed;
+            }
+        }
+
+        isAddingFromMidiInput = false;
     }
 
-    // Handle pedal release - optimized for MSVC 
-    void handlePedalRelease(double timeStamp)
+    // Send note-offs for the voices a pedal just let go of, each on its own channel - optimized for MSVC
+    void releaseNotes(const PedalEngine::Voices& voices, uint32_t tick)
     {
-        // Cache this to avoid repeated atomic loads
-        const bool shouldLog = loggingEnabled.load(std::memory_order_relaxed);
+        const bool shouldSpread = releaseSpreader.isEnabled();
+        releaseScratch.clear();
 
-        // Process both bitmap segments
-        for (size_t k = 0; k < 2; ++k)
+        for (uint32_t channels = voices.channels; channels != 0; channels &= channels - 1)
         {
-            uint64_t bitset = sostenutoPedalHeldNotesBitmap[k];
+            const int c = countTrailingZeros(channels);
+            const int channel = c + 1;
+            const auto& notes = voices.notes[c];
 
-            // Process all set bits
-            while (bitset != 0)
+            // Process both bitmap segments
+            for (size_t k = 0; k < 2; ++k)
             {
-                // Find and clear lowest set bit
-                // MSVC-friendly bit manipulation
+                uint64_t bitset = notes[k];
+
+                // Process all set bits
+                while (bitset != 0)
+                {
+                    // Find and clear lowest set bit
+                    // MSVC-friendly bit manipulation
 #if defined(_MSC_VER)
-                unsigned long bitIndex;
-                _BitScanForward64(&bitIndex, bitset);
-                uint64_t mask = 1ULL << bitIndex;
-                bitset &= ~mask;  // Clear the bit
-                int note = k * 64 + static_cast<int>(bitIndex);
+                    unsigned long bitIndex;
+                    _BitScanForward64(&bitIndex, bitset);
+                    uint64_t mask = 1ULL << bitIndex;
+                    bitset &= ~mask;  // Clear the bit
+                    int note = k * 64 + static_cast<int>(bitIndex);
 #else
-                uint64_t t = bitset & -bitset;
-                int r = countTrailingZeros(bitset);
-                bitset ^= t;  // Clear the bit
-                int note = k * 64 + r;
+                    uint64_t t = bitset & -bitset;
+                    int r = countTrailingZeros(bitset);
+                    bitset ^= t;  // Clear the bit
+                    int note = k * 64 + r;
 #endif
 
-                // Only send note-off if the note isn't physically pressed
-                if (!keyboardState.isNoteOn(1, note) && midiOutput != nullptr)
-                {
-                    auto noteOff = juce::MidiMessage::noteOff(1, note);
-                    noteOff.setTimeStamp(timeStamp);
-                    midiOutput->sendMessageNow(noteOff);
-
-                    // Log if enabled (separate, non-blocking path)
-                    if (shouldLog)
-                    {
-                        int start1, size1, start2, size2;
-                        logFifo.prepareToWrite(1, start1, size1, start2, size2);
-
-                        if (size1 + size2 > 0)
-                        {
-                            const int writeIndex = size1 == 1 ? start1 : start2;
-                            logEntries[writeIndex] = { noteOff, "Sostenuto Release", noteOff.getTimeStamp() };
-                            logFifo.finishedWrite(1);
-                        }
-                    }
+                    // The engine never releases a note that is still physically pressed
+                    const auto noteOff = PackedMidiEvent::noteOff(channel, note, tick);
+
+                    if (shouldSpread)
+                        releaseScratch.push_back({ static_cast<uint8_t>(channel), static_cast<uint8_t>(note), strikeTicks[c][note] });
+                    else
+                        sendToOutput(noteOff);
+
+                    logEvent(noteOff, LogSource::pedalRelease);
                 }
             }
         }
 
-        // Reset bitmap after processing all notes
-        sostenutoPedalHeldNotesBitmap[0] = 0;
-        sostenutoPedalHeldNotesBitmap[1] = 0;
+        // Spread over the window; the scheduler's release lane holds each until it is due
+        releaseSpreader.schedule(releaseScratch, tick, [this, tick](const ReleaseSpreader::Voice& voice, double delayMs) {
+            const auto noteOff = PackedMidiEvent::noteOff(voice.channel, voice.note, tick);
+            polyphonyBudget.noteOff(voice.channel, voice.note);
+            engineEvents.publishNote(noteOff, true);
+
+            outputScheduler.enqueueReleaseWaiting(noteOff, delayMs);
+        });
     }
 
     // Platform-independent trailing zero count
@@ -963,43 +1862,82 @@ private:
     static constexpr int MAX_LOG_LINES = 500; // Maximum number of lines to keep in the log
     static constexpr int LOG_TIMER_FREQUENCY = 30; // Hz
     static constexpr size_t LOG_CHUNK_SIZE = 16; // Process logs in chunks of this size
+    static constexpr int pianoRollHeight = 120;
+    static constexpr int linkModelWidth = 150;
 
     double startTime = 0;
     std::atomic<bool> loggingEnabled{ false }; // Start with logging disabled
     std::atomic<bool> isAddingFromMidiInput{ false };
     int currentLogLines = 0;
-    int lastInputIndex = 0;
+    std::unique_ptr<InputTap> inputTaps[MidiInputMerger::MAX_INPUTS]; // Message thread only
+    juce::String inputNames[MidiInputMerger::MAX_INPUTS]; // For log entries, message thread only
 
     // Audio and MIDI handling
     juce::AudioDeviceManager deviceManager;
-    std::unique_ptr<juce::MidiOutput> midiOutput = nullptr;
     juce::MidiKeyboardState keyboardState;
-    juce::MidiBuffer midiMessageBuffer;
+    IngressSequencer ingress; // Sequence numbers and the deferred lane (guarded by midiProcessLock)
+    MidiCoalescer batchCoalescer;
+    EventClassifier batchClassifier; // Guarded by midiProcessLock
 
     // Thread-safe data structures
-    std::unique_ptr<juce::ThreadPool> midiThreadPool;
-    juce::AbstractFifo midiFifo{ 256 }; // Smaller size for better performance
-    std::array<juce::MidiMessage, 256> midiMessageArray;
     juce::CriticalSection midiProcessLock;
+    EngineEventStream engineEvents; // Published for the piano roll
+    juce::CriticalSection outputLock;
+    MidiWireEncoder wireEncoder;
+    OutputRouter outputRouter; // Destinations change under outputLock
+    juce::String outputError;  // Why the last output switched on did not attach; message thread only
 
     // Logging components
     juce::AbstractFifo logFifo{ 512 }; // Smaller buffer for better performance
     std::vector<LogEntry> logEntries{ 512 };
     std::unique_ptr<LogTimer> logTimer;
-    juce::CriticalSection logMutex;
 
     // UI Components
-    juce::ComboBox midiInputList;
+    DeviceListBox midiInputList;
     juce::Label midiInputListLabel;
-    juce::ComboBox midiOutputList;
+    DeviceListBox midiOutputList;
     juce::Label midiOutputListLabel;
-    juce::MidiKeyboardComponent keyboardComponent;
+    SostenutoKeyboardComponent keyboardComponent;
     juce::TextEditor midiMessagesBox;
     PedalButton sostenutoPedalButton;
     juce::ToggleButton loggingEnabledButton;
+    juce::ToggleButton pianoRollButton;
+    juce::ToggleButton runningStatusButton;
+    juce::ToggleButton pedalEmulationButton;
+    juce::TextButton pedalMapButton;
+    juce::TextButton panicButton;
+    juce::Label statusLabel;
+    juce::ComboBox linkModelList;
+    juce::Label linkModelListLabel;
+    juce::ComboBox sysExRateList;
+    juce::Label sysExRateListLabel;
+    OutputScheduler outputScheduler; // Declared last so it stops before anything it writes to
+    MidiInputMerger inputMerger;     // ...and this after it, since the merged stream feeds it
+    PianoRollComponent pianoRoll;
 
     // Sostenuto pedal state
-    uint64_t sostenutoPedalHeldNotesBitmap[2] = { 0, 0 };
+    PedalEngine pedalEngine;
+    PedalMapper pedalMapper;
+
+    // MIDI 2.0 destination, written under outputLock
+    std::atomic<Ump::Receiver*> umpOutput{ nullptr };
+    bool umpSysExOpen = false;
+    OutputLedger outputLedger; // Notes sounding on the output, under outputLock
+    NoteOutputFilter noteFilter; // Redundant note suppression against outputLedger, under outputLock
+
+    // Pedal-release spreading
+    ReleaseSpreader releaseSpreader;
+    std::vector<ReleaseSpreader::Voice> releaseScratch = std::vector<ReleaseSpreader::Voice>(PedalEngine::NUM_CHANNELS * 128); // Sized once, cleared per release
+    uint32_t strikeTicks[PedalEngine::NUM_CHANNELS][128] = {};
+
+    PolyphonyBudget polyphonyBudget;
+    FeedbackLoopDetector loopDetector;
+    StuckNoteReaper stuckNoteReaper;
+    std::atomic<uint64_t> publishedHeldBitmap[2] = { {0}, {0} }; // Read by the keyboard view
+    std::atomic<uint64_t> publishedPressedBitmap[16][2] = {};    // Read by showPressedNotes()
+    uint64_t shownPressedBitmap[16][2] = {};                     // Message thread only
+    std::atomic<bool> publishedSostenutoDown{ false };           // Read by showPedalButton()
+    bool shownSostenutoDown = false;                             // Message thread only
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MainContentComponent)
 };
\ No newline at end of file
@@ -0,0 +1,291 @@
+#pragma once
+#include "LockFreeMpscQueue.h"
+#include "PackedMidiEvent.h"
+#include "PedalEngine.h"
+#include "PedalMapper.h"
+
+// The pedal engine split across worker threads by channel group, for installations where dozens
+// of inputs (a sequencer driving many parts) make a single engine thread the bottleneck.
+//
+// Channels are dealt round-robin to the shards (channel 1 to shard 0, channel 2 to shard 1, ...),
+// so a sequencer that fills channels from 1 upwards spreads evenly. Each shard is a thread that
+// owns a whole PedalEngine but only ever has notes on its own channels, so the shards share no
+// state and take no lock. The single producer (the merge thread) hands each event to the shard
+// owning its channel; a pedal whose scope spans several shards - an MPE master-channel pedal -
+// goes to each of them, and each releases whatever it holds in that scope.
+//
+// Every shard writes its output into its own ring. The output stage drains them with the same
+// k-way merge by tick as MidiInputMerger, so output from different shards meets in timestamp
+// order and each shard's own output keeps its order.
+//
+// Only EngineScalingBenchmark drives it so far. The app keeps a single PedalEngine, because
+// everything after it - the polyphony budget, the stuck note reaper, panic and the on-screen
+// keyboard - reads that engine's state.
+class ShardedPedalEngine
+{
+public:
+    static constexpr int MAX_SHARDS = PedalEngine::NUM_CHANNELS;
+
+    ShardedPedalEngine(const PedalMapper& mapperToUse, int numShardsToUse)
+        : mapper(mapperToUse),
+        numShards(juce::jlimit(1, MAX_SHARDS, numShardsToUse))
+    {
+        for (int i = 0; i < numShards; ++i)
+            shards[i] = std::make_unique<Shard>(*this, i);
+    }
+
+    ~ShardedPedalEngine()
+    {
+        stop();
+    }
+
+    void start()
+    {
+        for (int i = 0; i < numShards; ++i)
+            shards[i]->start();
+    }
+
+    void stop()
+    {
+        for (int i = 0; i < numShards; ++i)
+            shards[i]->stop();
+    }
+
+    int getNumShards() const { return numShards; }
+
+    // Call before start(), or while nothing is pedalled
+    void setMpeMode(bool shouldUseMpe)
+    {
+        mpeMode = shouldUseMpe;
+
+        for (int i = 0; i < numShards; ++i)
+            shards[i]->engine.setMpeMode(shouldUseMpe);
+    }
+
+    // Single producer. Returns false if a shard's ring is full, in which case the event is lost.
+    bool push(const PackedMidiEvent& event)
+    {
+        const int status = event.getStatus();
+
+        // Channel-less messages pass straight through the first shard
+        if (status >= 0xf0)
+            return route(0, event);
+
+        const int channel = (status & 0x0f) + 1;
+
+        if (!(mpeMode && channel == PedalEngine::MPE_MASTER_CHANNEL && mapper.isMapped(event)))
+            return route(getShard(channel), event);
+
+        bool accepted = true;
+        for (int i = 0; i < numShards; ++i)
+            accepted = route(i, event) && accepted;
+
+        return accepted;
+    }
+
+    // True once the shards have processed everything pushed so far (producer side)
+    bool isIdle() const { return getProcessedCount() == routed; }
+
+    // Single consumer (the output stage): hand every available output event to fn in tick order
+    // across shards. Returns the number handed on.
+    template <typename Fn>
+    int drain(Fn&& fn)
+    {
+        int count = 0;
+
+        for (;;)
+        {
+            int earliest = -1;
+
+            for (int i = 0; i < numShards; ++i)
+            {
+                if (!hasHead[i])
+                    hasHead[i] = shards[i]->output.pop(heads[i]);
+
+                // Tick differences are wrap-safe
+                if (hasHead[i] && (earliest < 0 || static_cast<int32_t>(heads[i].tick - heads[earliest].tick) < 0))
+                    earliest = i;
+            }
+
+            if (earliest < 0)
+                return count;
+
+            fn(heads[earliest]);
+            hasHead[earliest] = false;
+            ++count;
+        }
+    }
+
+    // Events every shard has finished with, counting a broadcast pedal once per shard it reached
+    int64_t getProcessedCount() const
+    {
+        int64_t total = 0;
+        for (int i = 0; i < numShards; ++i)
+            total += shards[i]->processed.load(std::memory_order_acquire);
+
+        return total;
+    }
+
+    int64_t getDroppedCount() const
+    {
+        int64_t total = 0;
+        for (int i = 0; i < numShards; ++i)
+            total += shards[i]->dropped.load(std::memory_order_relaxed);
+
+        return total;
+    }
+
+private:
+    class Shard : private juce::Thread
+    {
+    public:
+        Shard(ShardedPedalEngine& ownerToUse, int index)
+            : juce::Thread("Pedal Engine Shard " + juce::String(index + 1)),
+            owner(ownerToUse)
+        {
+        }
+
+        void start() { startThread(juce::Thread::Priority::highest); }
+
+        void stop()
+        {
+            signalThreadShouldExit();
+            wakeUp.signal();
+            stopThread(2000);
+        }
+
+        bool push(const PackedMidiEvent& event)
+        {
+            if (!input.push(event))
+            {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+
+            // Pairs with the fence in run(), as in MidiInputMerger::push()
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if (parked.load(std::memory_order_relaxed))
+                wakeUp.signal();
+
+            return true;
+        }
+
+        PedalEngine engine; // Only this shard's thread touches it once started
+        LockFreeMpscQueue<PackedMidiEvent, 8192> output;
+        std::atomic<int64_t> processed{ 0 };
+        std::atomic<int64_t> dropped{ 0 };
+
+    private:
+        static constexpr int IDLE_WAIT_MS = 100;
+
+        void run() override
+        {
+            while (!threadShouldExit())
+            {
+                PackedMidiEvent event;
+                while (input.pop(event))
+                {
+                    process(event);
+                    processed.fetch_add(1, std::memory_order_release);
+                }
+
+                parked.store(true, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+
+                if (input.getNumReady() == 0)
+                    wakeUp.wait(IDLE_WAIT_MS);
+
+                parked.store(false, std::memory_order_relaxed);
+            }
+        }
+
+        // What MainContentComponent::processMidiRealTime() does with one event, on this shard's
+        // channels
+        void process(const PackedMidiEvent& event)
+        {
+            PedalMapper::Change change;
+
+            if (owner.mapper.map(event, engine, change))
+            {
+                PedalEngine::Voices release;
+                engine.setPedal(change.pedal, change.isDown, engine.getScope(event.getChannel()), release);
+
+                for (uint16_t channels = release.channels; channels != 0; channels &= channels - 1)
+                {
+                    const int c = countTrailingZeros(channels);
+
+                    for (int k = 0; k < 2; ++k)
+                        for (uint64_t bits = release.notes[c][k]; bits != 0; bits &= bits - 1)
+                            emit(PackedMidiEvent::noteOff(c + 1, k * 64 + countTrailingZeros(bits), event.tick));
+                }
+
+                return;
+            }
+
+            if (event.isNoteOn())
+            {
+                engine.noteOn(event.getChannel(), event.getData1());
+                emit(PackedMidiEvent::make(event.getStatus(), event.getData1(),
+                    engine.scaleVelocity(event.getChannel(), event.getData2()), event.tick));
+            }
+            else if (!event.isNoteOff() || engine.noteOff(event.getChannel(), event.getData1()))
+            {
+                emit(event);
+            }
+        }
+
+        // A full ring means the output stage has fallen behind: wait for it rather than lose a
+        // note-off
+        void emit(const PackedMidiEvent& event)
+        {
+            while (!output.push(event))
+            {
+                if (threadShouldExit())
+                    return;
+
+                juce::Thread::yield();
+            }
+        }
+
+        static int countTrailingZeros(uint64_t x)
+        {
+#if defined(_MSC_VER)
+            unsigned long index;
+            _BitScanForward64(&index, x);
+            return static_cast<int>(index);
+#elif defined(__GNUC__) || defined(__clang__)
+            return __builtin_ctzll(x);
+#else
+            int count = 0;
+            while ((x & 1) == 0) { x >>= 1; ++count; }
+            return count;
+#endif
+        }
+
+        ShardedPedalEngine& owner;
+        LockFreeMpscQueue<PackedMidiEvent, 4096> input;
+        std::atomic<bool> parked{ false };
+        juce::WaitableEvent wakeUp;
+    };
+
+    int getShard(int channel) const { return (channel - 1) % numShards; }
+
+    bool route(int shard, const PackedMidiEvent& event)
+    {
+        if (!shards[shard]->push(event))
+            return false;
+
+        ++routed;
+        return true;
+    }
+
+    //==============================================================================
+    const PedalMapper& mapper;
+    const int numShards;
+    bool mpeMode = false; // Producer side
+    int64_t routed = 0;   // Producer side
+    std::unique_ptr<Shard> shards[MAX_SHARDS];
+    PackedMidiEvent heads[MAX_SHARDS]; // Oldest unmerged output of each shard (consumer only)
+    bool hasHead[MAX_SHARDS] = {};
+};
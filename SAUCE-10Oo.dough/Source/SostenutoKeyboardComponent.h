@@ -0,0 +1,232 @@
+#pragma once
+
+// On-screen keyboard that also shows which keys the sostenuto bitmap is holding.
+// Keys are blitted from pre-rendered images and only keys whose state changed get repainted.
+class SostenutoKeyboardComponent : public juce::MidiKeyboardComponent
+{
+public:
+    // Colours for the three non-idle key states
+    enum ColourIds
+    {
+        pressedKeyColourId = 0x1fff001,   // physically down, not captured by the pedal
+        heldKeyColourId = 0x1fff002,      // physically down and captured by the pedal
+        sustainedKeyColourId = 0x1fff003  // released but still sounding because of the pedal
+    };
+
+    SostenutoKeyboardComponent(juce::MidiKeyboardState& state, Orientation orientation)
+        : juce::MidiKeyboardComponent(state, orientation),
+        repaintTimer(this)
+    {
+        setColour(pressedKeyColourId, juce::Colour(0xff6fa8dc));
+        setColour(heldKeyColourId, juce::Colour(0xffd4a017));
+        setColour(sustainedKeyColourId, juce::Colour(0xffb8860b).withAlpha(0.6f));
+
+        repaintTimer.startTimerHz(REPAINT_TIMER_FREQUENCY);
+    }
+
+    ~SostenutoKeyboardComponent() override
+    {
+        repaintTimer.stopTimer();
+    }
+
+    // Point the keyboard at the engine's published sostenuto bitmap (2 x 64 bits)
+    void setSostenutoSource(const std::atomic<uint64_t>* bitmap)
+    {
+        sostenutoSource = bitmap;
+        checkSostenutoState();
+    }
+
+    void resized() override
+    {
+        juce::MidiKeyboardComponent::resized();
+        rebuildKeyImages();
+    }
+
+    void colourChanged() override
+    {
+        juce::MidiKeyboardComponent::colourChanged();
+        rebuildKeyImages();
+    }
+
+    // Compare the published bitmap with what was last drawn and repaint only the differences
+    void checkSostenutoState()
+    {
+        if (sostenutoSource == nullptr)
+            return;
+
+        for (size_t k = 0; k < 2; ++k)
+        {
+            const uint64_t current = sostenutoSource[k].load(std::memory_order_acquire);
+            uint64_t changed = current ^ drawnSostenutoBitmap[k];
+            drawnSostenutoBitmap[k] = current;
+
+            while (changed != 0)
+            {
+                const int note = static_cast<int>(k) * 64 + countTrailingZeros(changed);
+                changed &= changed - 1; // Clear lowest set bit
+                repaint(getRectangleForKey(note).getSmallestIntegerContainer());
+            }
+        }
+    }
+
+protected:
+    void drawWhiteNote(int midiNoteNumber, juce::Graphics& g, juce::Rectangle<float> area,
+        bool isDown, bool isOver, juce::Colour /*lineColour*/, juce::Colour textColour) override
+    {
+        // The base class walks every key - skip the ones outside the dirty region
+        if (!g.clipRegionIntersects(area.getSmallestIntegerContainer()))
+            return;
+
+        g.drawImage(whiteKeyImages[getKeyState(midiNoteNumber, isDown)], area);
+
+        if (isOver)
+        {
+            g.setColour(findColour(mouseOverKeyOverlayColourId));
+            g.fillRect(area);
+        }
+
+        const auto text = getWhiteNoteText(midiNoteNumber);
+
+        if (text.isNotEmpty())
+        {
+            g.setColour(textColour);
+            g.setFont(juce::jmin(12.0f, getKeyWidth() * 0.9f));
+            g.drawText(text, area.withTrimmedLeft(1.0f).withTrimmedBottom(2.0f),
+                juce::Justification::centredBottom, false);
+        }
+    }
+
+    void drawBlackNote(int midiNoteNumber, juce::Graphics& g, juce::Rectangle<float> area,
+        bool isDown, bool isOver, juce::Colour /*noteFillColour*/) override
+    {
+        if (!g.clipRegionIntersects(area.getSmallestIntegerContainer()))
+            return;
+
+        g.drawImage(blackKeyImages[getKeyState(midiNoteNumber, isDown)], area);
+
+        if (isOver)
+        {
+            g.setColour(findColour(mouseOverKeyOverlayColourId));
+            g.fillRect(area);
+        }
+    }
+
+private:
+    // Timer class to poll the sostenuto bitmap at a fixed rate
+    class RepaintTimer : public juce::Timer
+    {
+    public:
+        RepaintTimer(SostenutoKeyboardComponent* owner) : owner(owner) {}
+        void timerCallback() override { owner->checkSostenutoState(); }
+    private:
+        SostenutoKeyboardComponent* owner;
+    };
+
+    enum KeyState
+    {
+        idleKey = 0,
+        pressedKey,
+        heldKey,
+        sustainedKey,
+        numKeyStates
+    };
+
+    // Branchless state lookup: bit 0 = physically down, bit 1 = captured by sostenuto
+    KeyState getKeyState(int note, bool isDown) const
+    {
+        static constexpr KeyState states[4] = { idleKey, pressedKey, sustainedKey, heldKey };
+        const bool isCaptured = ((drawnSostenutoBitmap[(note >> 6) & 1] >> (note & 63)) & 1) != 0;
+        return states[(int)isDown | ((int)isCaptured << 1)];
+    }
+
+    // Pre-render one image per key colour and state so paint() is only blits
+    void rebuildKeyImages()
+    {
+        const float keyWidth = getKeyWidth();
+        const bool isHorizontal = getOrientation() == horizontalKeyboard;
+        const int length = isHorizontal ? getHeight() : getWidth();
+
+        if (keyWidth <= 0.0f || length <= 0)
+            return;
+
+        const int whiteW = juce::jmax(1, juce::roundToInt(keyWidth));
+        const int whiteH = length;
+        const int blackW = juce::jmax(1, juce::roundToInt(keyWidth * getBlackNoteWidthProportion()));
+        const int blackH = juce::jmax(1, juce::roundToInt(length * getBlackNoteLengthProportion()));
+
+        const juce::Colour overlays[numKeyStates] = {
+            juce::Colours::transparentBlack,
+            findColour(pressedKeyColourId),
+            findColour(heldKeyColourId),
+            findColour(sustainedKeyColourId)
+        };
+
+        for (int state = 0; state < numKeyStates; ++state)
+        {
+            whiteKeyImages[state] = renderKeyImage(isHorizontal ? whiteW : whiteH, isHorizontal ? whiteH : whiteW,
+                findColour(whiteNoteColourId), overlays[state], true);
+            blackKeyImages[state] = renderKeyImage(isHorizontal ? blackW : blackH, isHorizontal ? blackH : blackW,
+                findColour(blackNoteColourId), overlays[state], false);
+        }
+
+        repaint();
+    }
+
+    juce::Image renderKeyImage(int width, int height, juce::Colour base, juce::Colour overlay, bool isWhite) const
+    {
+        juce::Image image(juce::Image::ARGB, width, height, true);
+        juce::Graphics g(image);
+        auto bounds = image.getBounds().toFloat();
+
+        g.setColour(base.overlaidWith(overlay));
+        g.fillRect(bounds);
+
+        if (isWhite)
+        {
+            // Separator line on the trailing edge of each white key
+            g.setColour(findColour(keySeparatorLineColourId));
+            if (getOrientation() == horizontalKeyboard)
+                g.fillRect(bounds.removeFromRight(1.0f));
+            else
+                g.fillRect(bounds.removeFromBottom(1.0f));
+        }
+        else
+        {
+            // Slight bevel so black keys stay readable when coloured
+            g.setColour(base.overlaidWith(overlay).brighter(0.3f));
+            g.drawRect(bounds.reduced(bounds.getWidth() * 0.125f, 0.0f).withTrimmedBottom(bounds.getHeight() * 0.1f), 1.0f);
+        }
+
+        return image;
+    }
+
+    // Platform-independent trailing zero count
+    static inline int countTrailingZeros(uint64_t x)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, x);
+        return static_cast<int>(index);
+#elif defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctzll(x);
+#else
+        int count = 0;
+        while ((x & 1) == 0) {
+            x >>= 1;
+            count++;
+        }
+        return count;
+#endif
+    }
+
+    //==============================================================================
+    static constexpr int REPAINT_TIMER_FREQUENCY = 60; // Hz
+
+    const std::atomic<uint64_t>* sostenutoSource = nullptr;
+    uint64_t drawnSostenutoBitmap[2] = { 0, 0 };
+    juce::Image whiteKeyImages[numKeyStates];
+    juce::Image blackKeyImages[numKeyStates];
+    RepaintTimer repaintTimer;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SostenutoKeyboardComponent)
+};
@@ -0,0 +1,206 @@
+#pragma once
+
+// Watchdog for notes that never get their note-off (a flaky USB-MIDI cable drops one, a device
+// is unplugged mid-phrase). Every note-on written to the output arms a deadline for its voice and
+// every note-off cancels it; a voice still sounding after the maximum duration is handed back to
+// the owner to release.
+//
+// The deadlines live in a three-level hierarchical timing wheel of 10 ms ticks:
+//
+//   level 0: 256 slots x 10 ms     (2.56 s)
+//   level 1:  64 slots x 2.56 s    (2.7 min)
+//   level 2:  64 slots x 2.7 min   (2.9 h)
+//
+// Each of the 16 x 128 voices is a node in an intrusive list threaded through fixed arrays, so
+// arming, re-arming and cancelling are O(1) with no allocation and no per-note timer. A slot of a
+// higher level is cascaded down when the level below wraps, so advancing costs O(1) per tick plus
+// O(1) per deadline.
+class StuckNoteReaper
+{
+public:
+    StuckNoteReaper()
+    {
+        std::fill(std::begin(heads), std::end(heads), NONE);
+        std::fill(std::begin(slotOf), std::end(slotOf), NONE);
+        currentTick = juce::Time::getMillisecondCounter() / TICK_MS;
+    }
+
+    // 0 disables the watchdog and forgets every deadline
+    void setMaxDurationMs(int ms)
+    {
+        maxDurationMs.store(juce::jlimit(0, MAX_DURATION_MS, ms), std::memory_order_relaxed);
+
+        if (ms <= 0)
+            reset();
+    }
+
+    int getMaxDurationMs() const { return maxDurationMs.load(std::memory_order_relaxed); }
+
+    // A note-on reached the output (a re-strike restarts the clock)
+    void arm(int channel, int note)
+    {
+        const int duration = getMaxDurationMs();
+
+        if (duration <= 0)
+            return;
+
+        const juce::SpinLock::ScopedLockType sl(lock);
+        const int key = toKey(channel, note);
+        unlink(key);
+        insert(key, (juce::Time::getMillisecondCounter() + static_cast<uint32_t>(duration) + TICK_MS - 1) / TICK_MS); // Never early
+    }
+
+    // A note-off reached the output
+    void cancel(int channel, int note)
+    {
+        const juce::SpinLock::ScopedLockType sl(lock);
+        unlink(toKey(channel, note));
+    }
+
+    void reset()
+    {
+        const juce::SpinLock::ScopedLockType sl(lock);
+        std::fill(std::begin(heads), std::end(heads), NONE);
+        std::fill(std::begin(slotOf), std::end(slotOf), NONE);
+    }
+
+    // Run the wheel up to now and call fn(channel, note) for every voice past its deadline.
+    // fn returns true if it released the voice, or false to give it another full duration (a
+    // note a pedal is legitimately holding). fn is called without the lock held, so it may
+    // write to the output.
+    template <typename Fn>
+    void advance(Fn&& fn)
+    {
+        int numExpired = 0;
+
+        {
+            const juce::SpinLock::ScopedLockType sl(lock);
+            const uint32_t target = juce::Time::getMillisecondCounter() / TICK_MS;
+
+            while (static_cast<int32_t>(target - currentTick) > 0)
+            {
+                ++currentTick;
+
+                if ((currentTick & LEVEL0_MASK) == 0)
+                {
+                    if (((currentTick >> LEVEL0_BITS) & LEVEL_MASK) == 0)
+                        cascade(LEVEL2_BASE + static_cast<int>((currentTick >> (LEVEL0_BITS + LEVEL_BITS)) & LEVEL_MASK));
+
+                    cascade(LEVEL1_BASE + static_cast<int>((currentTick >> LEVEL0_BITS) & LEVEL_MASK));
+                }
+
+                // Everything left in this level-0 slot is due now
+                const int slot = static_cast<int>(currentTick & LEVEL0_MASK);
+
+                for (int key = heads[slot]; key != NONE; key = next[key])
+                {
+                    slotOf[key] = NONE;
+                    expired[numExpired++] = static_cast<int16_t>(key);
+                }
+
+                heads[slot] = NONE;
+            }
+        }
+
+        for (int i = 0; i < numExpired; ++i)
+        {
+            const int key = expired[i];
+
+            if (fn((key >> 7) + 1, key & 0x7f))
+                reaped.fetch_add(1, std::memory_order_relaxed);
+            else
+                arm((key >> 7) + 1, key & 0x7f);
+        }
+    }
+
+    int64_t getReapedCount() const { return reaped.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr uint32_t TICK_MS = 10;
+    static constexpr int MAX_DURATION_MS = 60 * 60 * 1000;
+    static constexpr int NUM_KEYS = 16 * 128;
+    static constexpr int16_t NONE = -1;
+
+    static constexpr int LEVEL0_BITS = 8;
+    static constexpr int LEVEL_BITS = 6;
+    static constexpr uint32_t LEVEL0_MASK = (1u << LEVEL0_BITS) - 1;
+    static constexpr uint32_t LEVEL_MASK = (1u << LEVEL_BITS) - 1;
+    static constexpr int LEVEL1_BASE = 1 << LEVEL0_BITS;
+    static constexpr int LEVEL2_BASE = LEVEL1_BASE + (1 << LEVEL_BITS);
+    static constexpr int NUM_SLOTS = LEVEL2_BASE + (1 << LEVEL_BITS);
+    static constexpr uint32_t MAX_DELTA = (1u << (LEVEL0_BITS + 2 * LEVEL_BITS)) - 1;
+
+    static int toKey(int channel, int note) { return ((channel - 1) & 0x0f) << 7 | (note & 0x7f); }
+
+    // Into the slot of the finest level whose span covers the deadline
+    void insert(int key, uint32_t deadline)
+    {
+        const int32_t ahead = static_cast<int32_t>(deadline - currentTick);
+        const uint32_t delta = ahead <= 0 ? 1u : juce::jmin(MAX_DELTA, static_cast<uint32_t>(ahead)); // Overdue - next tick
+        deadline = currentTick + delta;
+        int slot;
+
+        if (delta < (1u << LEVEL0_BITS))
+            slot = static_cast<int>(deadline & LEVEL0_MASK);
+        else if (delta < (1u << (LEVEL0_BITS + LEVEL_BITS)))
+            slot = LEVEL1_BASE + static_cast<int>((deadline >> LEVEL0_BITS) & LEVEL_MASK);
+        else
+            slot = LEVEL2_BASE + static_cast<int>((deadline >> (LEVEL0_BITS + LEVEL_BITS)) & LEVEL_MASK);
+
+        deadlines[key] = deadline;
+        slotOf[key] = static_cast<int16_t>(slot);
+        prev[key] = NONE;
+        next[key] = heads[slot];
+
+        if (heads[slot] != NONE)
+            prev[heads[slot]] = static_cast<int16_t>(key);
+
+        heads[slot] = static_cast<int16_t>(key);
+    }
+
+    void unlink(int key)
+    {
+        const int slot = slotOf[key];
+
+        if (slot == NONE)
+            return;
+
+        if (prev[key] != NONE)
+            next[prev[key]] = next[key];
+        else
+            heads[slot] = next[key];
+
+        if (next[key] != NONE)
+            prev[next[key]] = prev[key];
+
+        slotOf[key] = NONE;
+    }
+
+    // Move a higher-level slot's deadlines down now that they are within the level below's span.
+    // The list is detached first, so an entry that lands back in the same slot is not revisited.
+    void cascade(int slot)
+    {
+        int key = heads[slot];
+        heads[slot] = NONE;
+
+        while (key != NONE)
+        {
+            const int following = next[key];
+            slotOf[key] = NONE;
+            insert(key, deadlines[key]);
+            key = following;
+        }
+    }
+
+    //==============================================================================
+    juce::SpinLock lock;
+    uint32_t currentTick = 0;
+    int16_t heads[NUM_SLOTS];
+    int16_t next[NUM_KEYS] = {};
+    int16_t prev[NUM_KEYS] = {};
+    int16_t slotOf[NUM_KEYS];
+    uint32_t deadlines[NUM_KEYS] = {};
+    int16_t expired[NUM_KEYS] = {};
+    std::atomic<int> maxDurationMs{ 0 };
+    std::atomic<int64_t> reaped{ 0 };
+};
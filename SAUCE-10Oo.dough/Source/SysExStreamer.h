@@ -0,0 +1,129 @@
+#pragma once
+
+// Holds SysEx dumps in a preallocated block pool until the output scheduler sends them.
+// Each input writes its dump into the pool while it is still arriving, so a multi-megabyte
+// patch bank is never copied whole through the message thread, and no dump allocates on its
+// way to the scheduler. A dump is a chain of blocks; once complete it is handed over as its
+// first block, and the scheduler returns each block to the pool as soon as it has sent it.
+//
+// The free list is shared under a spin lock by the writers (input callbacks) and the scheduler
+// thread. A block's bytes belong to whoever took it, so copying needs no lock.
+class SysExStreamer
+{
+public:
+    static constexpr int CHUNK_BYTES = 256;
+    static constexpr int NUM_BLOCKS = 16384; // 4 MB
+    static constexpr int NO_BLOCK = -1;
+
+    // Partial dumps are copied in pieces of at least this much, not byte by byte
+    static constexpr int MIN_PARTIAL_BYTES = 32;
+
+    // A dump being written, owned by the single thread writing it
+    struct Dump
+    {
+        int first = NO_BLOCK;
+        int last = NO_BLOCK;
+        int size = 0;
+    };
+
+    SysExStreamer()
+        : blocks(static_cast<size_t>(NUM_BLOCKS) * CHUNK_BYTES)
+    {
+        for (int i = 0; i < NUM_BLOCKS; ++i)
+            freeBlocks[i] = NUM_BLOCKS - 1 - i;
+
+        numFree = NUM_BLOCKS;
+    }
+
+    // Append as much of data to the dump as the pool can take and return the number of bytes
+    // accepted. A partial dump that does not fit can resume once blocks come free.
+    int write(Dump& dump, const uint8_t* data, int size)
+    {
+        int written = 0;
+
+        // Top up the last block first
+        if (dump.last != NO_BLOCK && blockSizes[dump.last] < CHUNK_BYTES)
+        {
+            const int take = juce::jmin(CHUNK_BYTES - blockSizes[dump.last], size);
+            std::memcpy(getBlock(dump.last) + blockSizes[dump.last], data, static_cast<size_t>(take));
+            blockSizes[dump.last] += take;
+            written = take;
+        }
+
+        while (written < size)
+        {
+            const int block = take();
+
+            if (block == NO_BLOCK)
+                break;
+
+            const int count = juce::jmin(CHUNK_BYTES, size - written);
+            std::memcpy(getBlock(block), data + written, static_cast<size_t>(count));
+            blockSizes[block] = count;
+            nextBlocks[block] = NO_BLOCK;
+
+            if (dump.last == NO_BLOCK)
+                dump.first = block;
+            else
+                nextBlocks[dump.last] = block;
+
+            dump.last = block;
+            written += count;
+        }
+
+        dump.size += written;
+        return written;
+    }
+
+    // Return every block of a dump that will not be sent, counting it as dropped if it had begun
+    void discard(Dump& dump)
+    {
+        if (dump.first != NO_BLOCK)
+            droppedCount.fetch_add(1, std::memory_order_relaxed);
+
+        for (int block = dump.first; block != NO_BLOCK;)
+        {
+            const int next = nextBlocks[block];
+            release(block);
+            block = next;
+        }
+
+        dump = {};
+    }
+
+    // Scheduler thread, for a dump it has been handed
+    const uint8_t* getData(int block) const { return blocks.data() + static_cast<size_t>(block) * CHUNK_BYTES; }
+    int getSize(int block) const { return blockSizes[block]; }
+    int getNext(int block) const { return nextBlocks[block]; }
+
+    // Return a sent block to the pool
+    void release(int block)
+    {
+        const juce::SpinLock::ScopedLockType sl(lock);
+        freeBlocks[numFree++] = block;
+    }
+
+    // Statistics, safe to read from any thread
+    void recordSent(int size) { bytesSent.fetch_add(size, std::memory_order_relaxed); }
+    int64_t getBytesSent() const { return bytesSent.load(std::memory_order_relaxed); }
+    int64_t getDroppedCount() const { return droppedCount.load(std::memory_order_relaxed); }
+
+private:
+    uint8_t* getBlock(int block) { return blocks.data() + static_cast<size_t>(block) * CHUNK_BYTES; }
+
+    int take()
+    {
+        const juce::SpinLock::ScopedLockType sl(lock);
+        return numFree > 0 ? freeBlocks[--numFree] : NO_BLOCK;
+    }
+
+    //==============================================================================
+    juce::SpinLock lock;
+    std::vector<uint8_t> blocks; // Allocated once, NUM_BLOCKS x CHUNK_BYTES
+    int blockSizes[NUM_BLOCKS] = {};
+    int nextBlocks[NUM_BLOCKS] = {};
+    int freeBlocks[NUM_BLOCKS] = {};
+    int numFree = 0;
+    std::atomic<int64_t> bytesSent{ 0 };
+    std::atomic<int64_t> droppedCount{ 0 };
+};
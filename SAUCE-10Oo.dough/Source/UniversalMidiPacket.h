@@ -0,0 +1,201 @@
+#pragma once
+#include "PackedMidiEvent.h"
+
+// MIDI 2.0 Universal MIDI Packets, read and written word by word - no MIDI 1.0 byte stream in
+// between. Channel voice packets become a PackedMidiEvent (the 7-bit view the engine routes on)
+// plus the value at full resolution: 16-bit velocity for notes, 32 bits for controllers,
+// pressure and pitch bend. The engine carries that value alongside the event to the output,
+// so a MIDI 2.0 source reaching a MIDI 2.0 destination keeps every bit.
+//
+// Packets arrive and leave through JUCE's universal_midi_packets::Receiver, and values are scaled
+// with its Conversion helpers (the MIDI 2.0 min-center-max rules, so 0, the centre and the
+// maximum map exactly in both directions). The packing itself is done here: JUCE translates
+// whole MIDI 1.0 messages, while the engine holds a packed event plus its full value, and going
+// through a MidiMessage on every hop is exactly what this path avoids.
+struct Ump
+{
+    using Receiver = juce::universal_midi_packets::Receiver;
+    using Conversion = juce::universal_midi_packets::Conversion;
+
+    enum MessageType
+    {
+        utility = 0x0,
+        system = 0x1,
+        midi1ChannelVoice = 0x2,
+        sysEx7 = 0x3,
+        midi2ChannelVoice = 0x4
+    };
+
+    static constexpr int getMessageType(uint32_t firstWord) { return static_cast<int>(firstWord >> 28); }
+
+    static int getNumWords(uint32_t firstWord)
+    {
+        return static_cast<int>(juce::universal_midi_packets::Utils::getNumWordsForMessageType(firstWord));
+    }
+
+    static void send(Receiver& receiver, const uint32_t* words, double time)
+    {
+        receiver.packetReceived(juce::universal_midi_packets::View(words), time);
+    }
+
+    //==============================================================================
+    // A channel voice or system packet as the engine's event. Returns false for anything the
+    // engine does not route (utility, SysEx, per-note controllers, RPN/NRPN, and so on).
+    // hasFullValue is set for a MIDI 2.0 value with more resolution than the event holds - even
+    // when that value is 0 - and fullValue then carries it.
+    static bool toEvent(const uint32_t* words, uint32_t tick, PackedMidiEvent& event, uint32_t& fullValue, bool& hasFullValue)
+    {
+        const uint32_t w0 = words[0];
+        const int status = static_cast<int>((w0 >> 16) & 0xff);
+        const int index = static_cast<int>((w0 >> 8) & 0x7f);
+        fullValue = 0;
+        hasFullValue = false;
+
+        switch (getMessageType(w0))
+        {
+            case system:
+                if (status < 0xf1 || status == 0xf7)
+                    return false;
+
+                event = PackedMidiEvent::make(status, index, static_cast<int>(w0 & 0x7f), tick);
+                return true;
+
+            case midi1ChannelVoice:
+                event = PackedMidiEvent::make(status, index, static_cast<int>(w0 & 0x7f), tick);
+                return true;
+
+            case midi2ChannelVoice:
+                break;
+
+            default:
+                return false;
+        }
+
+        const uint32_t w1 = words[1];
+
+        switch (status & 0xf0)
+        {
+            case 0x80:
+            case 0x90:
+            {
+                fullValue = w1 >> 16;
+                hasFullValue = true;
+
+                // A MIDI 2.0 note-on may be very quiet but is never velocity 0
+                const int velocity = Conversion::scaleTo7(static_cast<uint16_t>(fullValue));
+                event = PackedMidiEvent::make(status, index, (status & 0xf0) == 0x90 ? juce::jmax(1, velocity) : velocity, tick);
+                return true;
+            }
+
+            case 0xa0:
+            case 0xb0:
+                fullValue = w1;
+                hasFullValue = true;
+                event = PackedMidiEvent::make(status, index, Conversion::scaleTo7(w1), tick);
+                return true;
+
+            case 0xc0:
+                event = PackedMidiEvent::make(status, static_cast<int>(w1 >> 24), 0, tick);
+                return true;
+
+            case 0xd0:
+                fullValue = w1;
+                hasFullValue = true;
+                event = PackedMidiEvent::make(status, Conversion::scaleTo7(w1), 0, tick);
+                return true;
+
+            case 0xe0:
+            {
+                fullValue = w1;
+                hasFullValue = true;
+                const auto bend = Conversion::scaleTo14(w1);
+                event = PackedMidiEvent::make(status, bend & 0x7f, bend >> 7, tick);
+                return true;
+            }
+
+            default:
+                return false;
+        }
+    }
+
+    // The event as a packet: MIDI 2.0 channel voice at full resolution (upscaling the 7-bit
+    // value when fullValue is 0), or a system packet. Returns the number of words written.
+    static int fromEvent(const PackedMidiEvent& event, uint32_t fullValue, uint32_t (&words)[2], int group = 0)
+    {
+        const auto status = static_cast<uint32_t>(event.getStatus());
+        const auto index = static_cast<uint32_t>(event.getData1());
+        const auto data2 = static_cast<uint32_t>(event.getData2());
+        const uint32_t groupBits = static_cast<uint32_t>(group & 0x0f) << 24;
+
+        if (status >= 0xf0)
+        {
+            words[0] = static_cast<uint32_t>(system) << 28 | groupBits | status << 16 | index << 8 | data2;
+            return 1;
+        }
+
+        uint32_t type = status & 0xf0;
+        uint32_t value = 0;
+
+        switch (type)
+        {
+            case 0x90:
+                // Note-on with velocity 0 is a note-off in MIDI 1.0 only
+                if (data2 == 0 && fullValue == 0)
+                    type = 0x80;
+
+                value = (fullValue != 0 ? fullValue : Conversion::scaleTo16(static_cast<uint8_t>(data2))) << 16;
+                break;
+
+            case 0x80: value = (fullValue != 0 ? fullValue : Conversion::scaleTo16(static_cast<uint8_t>(data2))) << 16; break;
+            case 0xa0:
+            case 0xb0: value = fullValue != 0 ? fullValue : Conversion::scaleTo32(static_cast<uint8_t>(data2)); break;
+            case 0xc0: value = index << 24; break;
+            case 0xd0: value = fullValue != 0 ? fullValue : Conversion::scaleTo32(static_cast<uint8_t>(index)); break;
+            case 0xe0: value = fullValue != 0 ? fullValue : Conversion::scaleTo32(static_cast<uint16_t>(index | data2 << 7)); break;
+            default:   break;
+        }
+
+        const uint32_t noteOrIndex = (type == 0xc0 || type == 0xd0 || type == 0xe0) ? 0 : index;
+        words[0] = static_cast<uint32_t>(midi2ChannelVoice) << 28 | groupBits | (type | (status & 0x0f)) << 16 | noteOrIndex << 8;
+        words[1] = value;
+        return 2;
+    }
+
+    //==============================================================================
+    // Split a SysEx chunk (a piece of an F0 ... F7 dump, as the output scheduler streams it)
+    // into 64-bit SysEx7 packets of up to six bytes. isOpen tracks a dump across chunks.
+    template <typename Fn>
+    static void forEachSysEx7Packet(const uint8_t* data, int size, bool& isOpen, Fn&& fn, int group = 0)
+    {
+        const bool starts = size > 0 && data[0] == 0xf0;
+        const bool ends = size > 0 && data[size - 1] == 0xf7;
+        const uint8_t* payload = data + (starts ? 1 : 0);
+        int remaining = size - (starts ? 1 : 0) - (ends ? 1 : 0);
+
+        if (starts)
+            isOpen = false;
+
+        do
+        {
+            const int count = juce::jmin(6, remaining);
+            const bool isLast = ends && count == remaining;
+
+            // 0 complete, 1 start, 2 continue, 3 end
+            const uint32_t status = !isOpen ? (isLast ? 0u : 1u) : (isLast ? 3u : 2u);
+
+            uint8_t bytes[6] = {};
+            std::memcpy(bytes, payload, static_cast<size_t>(juce::jmax(0, count)));
+
+            const uint32_t words[2] = {
+                static_cast<uint32_t>(sysEx7) << 28 | static_cast<uint32_t>(group & 0x0f) << 24 | status << 20
+                    | static_cast<uint32_t>(juce::jmax(0, count)) << 16 | static_cast<uint32_t>(bytes[0]) << 8 | bytes[1],
+                static_cast<uint32_t>(bytes[2]) << 24 | static_cast<uint32_t>(bytes[3]) << 16 | static_cast<uint32_t>(bytes[4]) << 8 | bytes[5]
+            };
+
+            fn(words);
+            isOpen = !isLast;
+            payload += juce::jmax(0, count);
+            remaining -= count;
+        } while (remaining > 0);
+    }
+};